@@ -6,6 +6,8 @@
 
 */
 
+#include "idents/BitFieldLayout.h"
+
 namespace idents {
 
   class AcdGapId {
@@ -79,7 +81,34 @@ namespace idents {
       m_val |= ( ThreeBitMask & col ) << ColShift;  
     }
 
+
+    /// positions in the arrays used by unpack() and pack(), in the
+    /// order of the fields in the packed value
+    enum { ColField = 0,
+	   RowField,
+	   FaceField,
+	   GapField,
+	   TypeField,
+	   NumFields};
+
+    /// all fields at once, to fields[ColField] through fields[TypeField]
+    inline void unpack(unsigned char* fields) const {
+      layout().unpack(m_val, fields);
+    }
+    /// set all fields at once; the inverse of unpack()
+    inline void pack(const unsigned char* fields) {
+      m_val = (unsigned short) layout().pack(fields);
+    }
+
   private:
+
+    static const BitFieldLayout& layout() {
+      static const unsigned char shifts[NumFields] = 
+	{ColShift, RowShift, FaceShift, GapShift, TypeShift};
+      static const unsigned char widths[NumFields] = {3, 3, 3, 3, 4};
+      static const BitFieldLayout fields(NumFields, shifts, widths);
+      return fields;
+    }
     
     unsigned short int m_val;
     
@@ -3,6 +3,7 @@
 
 #include "facilities/bitmanip.h"
 #include "idents/VolumeIdentifier.h"
+#include "idents/VolumeIdSchema.h"
 #include <iostream>
 #include <string>
 
@@ -46,6 +47,8 @@
 */
 
 namespace idents {
+class BitFieldLayout;
+
 class   AcdId {
 public:
     AcdId ();
@@ -126,6 +129,23 @@ public:
     /// returns col for tiles, ribbon # for ribbons
     inline short colLike() const; 
 
+    /// positions in the arrays used by unpack() and pack(), in the order
+    /// of the fields in the internal representation
+    enum {
+        colField = 0,   // column or ribbon number
+        rowField,
+        faceField,      // face or ribbon orientation
+        naField,
+        numFields
+    };
+
+    /// all fields at once, as colLike(), rowLike(), faceLike() and the
+    /// raw N/A bits (na() for those with face set)
+    void unpack(unsigned char* fields) const;
+
+    /// set all fields at once; the inverse of unpack()
+    void pack(const unsigned char* fields);
+
     /// Allow client to set the na bit
     inline void na( unsigned int val );
 
@@ -139,6 +159,8 @@ public:
 
 private:
     void constructorGuts(const idents::VolumeIdentifier &volid);
+    /// positions of the fields, in the order of unpack()
+    static const BitFieldLayout& layout();
     /// set layer
     inline void layer( unsigned int val );
     /// set the face number
@@ -166,8 +188,6 @@ private:
         faceShift = 8,
         naShift = 11,
         maxAcdTileFace = 4,
-        tileVolId = 40,
-        ribbonVolId = 41,
         ribbonX = 5,  // ribbons that extend along x-axis
         ribbonY = 6   // ribbons that extend along y-axis
     };
@@ -197,8 +217,12 @@ inline AcdId::~AcdId () {}
 
 
 inline bool AcdId::checkVolId(const idents::VolumeIdentifier &volId) {
-    if (volId[0] != 1) return false;
-    if ((volId[2] != tileVolId) && (volId[2] != ribbonVolId)) return false;
+    typedef idents::VolumeIdSchema Schema;
+    if (Schema::get(volId, Schema::fLATObjects) != 
+        Schema::value(Schema::eLATACD)) return false;
+    unsigned type = Schema::get(volId, Schema::fAcdType);
+    if ((type != Schema::value(Schema::eAcdTile)) && 
+        (type != Schema::value(Schema::eAcdRibbon))) return false;
     return true;
 }
 
@@ -210,23 +234,21 @@ inline unsigned int AcdId::id() const
 }
 
 inline const idents::VolumeIdentifier AcdId::volId(bool bent) {
-
+    typedef idents::VolumeIdSchema Schema;
     idents::VolumeIdentifier vId;
-    vId.append(1); 
+    Schema::set(vId, Schema::fLATObjects, Schema::value(Schema::eLATACD)); 
     if (na()) return vId;
-    vId.append(face()); 
+    Schema::set(vId, Schema::fAcdFace, face()); 
     if (tile()) {
-        vId.append(tileVolId);
-        vId.append(row());
-        vId.append(column()); 
-        if (bent) // signifies the bent portion of the detector
-            vId.append(1);
-        else
-            vId.append(0);
+        Schema::set(vId, Schema::fAcdType, Schema::value(Schema::eAcdTile));
+        Schema::set(vId, Schema::fAcdRow, row());
+        Schema::set(vId, Schema::fAcdColumn, column()); 
+        // signifies the bent portion of the detector
+        Schema::set(vId, Schema::fAcdBent, bent ? 1 : 0);
     } else {
-        vId.append(ribbonVolId);
-        vId.append(6-ribbonOrientation());
-        vId.append(ribbonNum());
+        Schema::set(vId, Schema::fAcdType, Schema::value(Schema::eAcdRibbon));
+        Schema::set(vId, Schema::fAcdRibbonOrient, 6-ribbonOrientation());
+        Schema::set(vId, Schema::fAcdRibbonNum, ribbonNum());
     }
 
     return vId;
@@ -252,30 +274,30 @@ inline short AcdId::na () const
 
 inline short AcdId::face () const
 { 
-    return bitmanip::word(2, (m_id & _facemask)); 
+    return (m_id & _facemask) >> faceShift; 
 }
 
 inline short AcdId::row () const 
 { 
-    if (tile()) return bitmanip::word (1, m_id); 
+    if (tile()) return (m_id & _rowmask) >> rowShift; 
     return -1;
 }
 
 inline short AcdId::ribbonNum () const
 { 
-    if (ribbon()) return bitmanip::word(0, (m_id & _ribbonmask)); 
+    if (ribbon()) return (m_id & _ribbonmask) >> colShift; 
     return -1;
 }
 
 inline short AcdId::ribbonOrientation () const
 {
-    if (ribbon()) return bitmanip::word(2, (m_id & _ribbonorientmask));
+    if (ribbon()) return (m_id & _ribbonorientmask) >> faceShift;
     return -1;
 }
 
 inline short AcdId::column () const 
 { 
-    if (tile()) return bitmanip::word (0, m_id); 
+    if (tile()) return (m_id & _colmask) >> colShift; 
     return -1;
 }
 
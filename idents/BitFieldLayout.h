@@ -0,0 +1,112 @@
+#ifndef idents_BitFieldLayout_h
+#define idents_BitFieldLayout_h
+
+#include "idents/BitOps.h"
+
+#ifdef _MSC_VER
+#include <stdlib.h>
+#endif
+
+namespace idents {
+
+/**
+ * @class BitFieldLayout
+ *
+ * @brief Placement of up to 8 bit fields in a word, with calls which
+ * extract or insert all of them at once.
+ *
+ * The packed id classes use this for their unpack() and pack() calls.
+ * Fields are listed in order of position, either from the least or
+ * from the most significant end of the word, and are at most 8 bits
+ * wide.  unpack() returns field k in byte k (bits 8k and up) of its
+ * result; pack() is the inverse, ignoring bits of each byte beyond
+ * the field's width.
+ *
+ * On processors with fast BMI2 each call is a pext and a pdep (and a
+ * byte swap for layouts listed from the most significant end);
+ * elsewhere it is a loop of shifts and masks.  The choice is made once,
+ * at startup, from cpuid.  AMD processors before Zen 3 implement
+ * pext and pdep in microcode, slower than the loop, so they use the
+ * loop.
+ */
+class BitFieldLayout {
+public:
+  typedef bitops::uint64 uint64;
+
+  enum { maxFields = 8 };
+
+  /// Layout of @a n fields, field k being @a widths[k] bits from bit
+  /// @a shifts[k].  Throws std::invalid_argument unless 1 <= n <= 8,
+  /// widths are 1 to 8 and fields are in order and do not overlap.
+  BitFieldLayout(unsigned n, const unsigned char* shifts,
+                 const unsigned char* widths);
+
+  unsigned count() const {return m_count;}
+
+  /// Bits of the word occupied by fields
+  uint64 mask() const {return m_mask;}
+
+  /// All fields of @a word, field k in byte k
+  uint64 unpack(uint64 word) const;
+
+  /// Word holding fields taken from the bytes of @a fields; bits
+  /// outside the fields are 0
+  uint64 pack(uint64 fields) const;
+
+  /// All fields of @a word, field k to @a fields[k], k < count()
+  void unpack(uint64 word, unsigned char* fields) const {
+    store(unpack(word), fields, m_count);
+  }
+
+  /// Word holding fields @a fields[k], k < count()
+  uint64 pack(const unsigned char* fields) const {
+    return pack(load(fields, m_count));
+  }
+
+  /// Bytes @a p[0..n) as a word, p[k] in byte k; n <= 8
+  static uint64 load(const unsigned char* p, unsigned n) {
+    uint64 word = 0;
+    for (unsigned k = 0; k < n; k++) word |= (uint64) p[k] << (8 * k);
+    return word;
+  }
+
+  /// Inverse of load()
+  static void store(uint64 word, unsigned char* p, unsigned n) {
+    for (unsigned k = 0; k < n; k++) p[k] = (unsigned char) (word >> (8 * k));
+  }
+
+  /// true if the pext/pdep versions are in use
+  static bool usesBmi2() {return s_bmi2;}
+
+  /// Select the pext/pdep versions if @a enable and the processor
+  /// has BMI2, the portable ones otherwise; returns usesBmi2().
+  /// Meant for testing and benchmarking.
+  static bool useBmi2(bool enable);
+
+private:
+  unsigned m_count;
+  /// Fields listed from the most significant end
+  bool m_descending;
+  uint64 m_mask;
+  /// Low bits of each byte, as many as the width of the field which
+  /// pext puts there (fields in increasing order of position)
+  uint64 m_laneMask;
+  unsigned char m_shift[maxFields];
+  unsigned char m_width[maxFields];
+
+  /// Reverse the order of the low count() bytes
+  uint64 reverseLanes(uint64 lanes) const {
+#if defined(_MSC_VER)
+    return _byteswap_uint64(lanes) >> (8 * (maxFields - m_count));
+#else
+    return __builtin_bswap64(lanes) >> (8 * (maxFields - m_count));
+#endif
+  }
+
+  /// Set at startup; until then (during static initialization) the
+  /// portable versions are used
+  static bool s_bmi2;
+};
+
+}
+#endif
@@ -0,0 +1,59 @@
+#ifndef idents_BitOps_h
+#define idents_BitOps_h
+
+/** 
+ * @file BitOps.h
+ * @brief Portable bit counting on 64-bit words, used by the 
+ * VolumeIdentifier containers.  Compiler builtins are used where 
+ * available.
+ */
+
+namespace idents {
+namespace bitops {
+
+#ifdef WIN32
+  typedef unsigned __int64 uint64;
+#else
+  typedef unsigned long long uint64;
+#endif
+
+  /// Number of set bits in @a x
+  inline unsigned popcount64(uint64 x) {
+#ifdef __GNUC__
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (unsigned) ((x * 0x0101010101010101ULL) >> 56);
+#endif
+  }
+
+  /// Index of least significant set bit of @a x, which must be non-zero
+  inline unsigned ctz64(uint64 x) {
+#ifdef __GNUC__
+    return __builtin_ctzll(x);
+#else
+    return popcount64((x & (0 - x)) - 1);
+#endif
+  }
+
+  /// Number of leading zero bits of @a x, which must be non-zero
+  inline unsigned clz64(uint64 x) {
+#ifdef __GNUC__
+    return __builtin_clzll(x);
+#else
+    // smear the top set bit downwards; the zeros are then all leading
+    x |= x >> 1;
+    x |= x >> 2;
+    x |= x >> 4;
+    x |= x >> 8;
+    x |= x >> 16;
+    x |= x >> 32;
+    return 64 - popcount64(x);
+#endif
+  }
+
+}
+}
+#endif
@@ -50,6 +50,7 @@ namespace idents {
 * $Header: /nfs/slac/g/glast/ground/cvs/idents/idents/CalXtalId.h,v 1.7 2004/10/15 17:37:25 jrb Exp $
 */
   class VolumeIdentifier;
+  class BitFieldLayout;
   
   class CalXtalId {
         
@@ -154,6 +155,26 @@ namespace idents {
       else return RANGE_UNUSED;
     }
 
+    /// positions in the arrays used by unpack() and pack(), in the
+    /// order of the fields in the packed word
+    enum {
+      COLUMN_FIELD = 0,
+      LAYER_FIELD,
+      TOWER_FIELD,
+      FACE_FIELD,
+      FACE_VALID_FIELD,
+      RANGE_FIELD,
+      RANGE_VALID_FIELD,
+      N_FIELDS
+    };
+
+    /// get all fields at once, including the face and range validity
+    /// bits, to fields[COLUMN_FIELD] through fields[RANGE_VALID_FIELD]
+    void unpack(unsigned char* fields) const;
+
+    /// set all fields at once; the inverse of unpack()
+    void pack(const unsigned char* fields);
+
     /// get measurement direction
     inline bool isX() const {return (getLayer()%2 == 0);};
             
@@ -188,6 +209,9 @@ namespace idents {
 
     /// Packed word containing Xtal ID = (tower*8 + layer)*16 + column
     unsigned int m_packedId;
+
+    /// positions of the fields, in the order of unpack()
+    static const BitFieldLayout& layout();
         
     /// private method to produce packed Id from tower, layer and column
     inline void packId(short tower, short layer, short column,
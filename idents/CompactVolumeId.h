@@ -0,0 +1,92 @@
+#ifndef idents_CompactVolumeId_h
+#define idents_CompactVolumeId_h
+
+#include "idents/VolumeIdentifier.h"
+#include <vector>
+#include <cstddef>
+
+namespace idents {
+
+/**
+ * @class CompactVolumeId
+ *
+ * @brief A tracker, calorimeter or ACD VolumeIdentifier in 32 bits,
+ * for storing large numbers of them.
+ *
+ * VolumeIdentifier gives every field 6 bits, though most need far
+ * fewer.  Here each field takes the number of bits given for its
+ * subsystem by the installed VolumeIdSchema, e.g. 2 for the tower
+ * coordinates and 1 for a view.  The fields are packed from the most
+ * significant bit down, and the size goes in the low 4 bits.
+ *
+ * Conversion in both directions is lossless.  Since the fields which
+ * tell subsystems apart are placed alike in every layout, compact ids
+ * sort in the same order as the identifiers they came from.
+ *
+ * An identifier can be represented if classify() gives a subsystem
+ * and each of its fields fits the width for that subsystem.
+ */
+class CompactVolumeId {
+public:
+  CompactVolumeId() : m_packedId(0) {}
+
+  /// Throws std::invalid_argument if @a vid cannot be represented
+  explicit CompactVolumeId(const VolumeIdentifier& vid);
+
+  /// Set @a out from @a vid; returns false, leaving @a out alone, if
+  /// @a vid cannot be represented
+  static bool fromVolumeId(const VolumeIdentifier& vid,
+                           CompactVolumeId& out);
+
+  VolumeIdentifier volumeId() const;
+
+  unsigned int getPackedId() const {return m_packedId;}
+  static CompactVolumeId fromPackedId(unsigned int packedId) {
+    CompactVolumeId id;
+    id.m_packedId = packedId;
+    return id;
+  }
+
+  /// Number of fields
+  int size() const {return m_packedId & 0xf;}
+
+  bool operator<(const CompactVolumeId& o) const {
+    return m_packedId < o.m_packedId;
+  }
+  bool operator==(const CompactVolumeId& o) const {
+    return m_packedId == o.m_packedId;
+  }
+  bool operator!=(const CompactVolumeId& o) const {
+    return m_packedId != o.m_packedId;
+  }
+
+  /**
+   * Convert @a n identifiers.  Stops at the first which cannot be
+   * represented; returns the number converted.
+   */
+  static std::size_t compact(const VolumeIdentifier* ids, std::size_t n,
+                             CompactVolumeId* out);
+
+  static std::size_t compact(const std::vector<VolumeIdentifier>& ids,
+                             std::vector<CompactVolumeId>& out) {
+    out.resize(ids.size());
+    if (ids.empty()) return 0;
+    return compact(&ids[0], ids.size(), &out[0]);
+  }
+
+  /// Convert @a n compact ids back to identifiers
+  static void expand(const CompactVolumeId* ids, std::size_t n,
+                     VolumeIdentifier* out);
+
+  static void expand(const std::vector<CompactVolumeId>& ids,
+                     std::vector<VolumeIdentifier>& out) {
+    out.resize(ids.size());
+    if (!ids.empty()) expand(&ids[0], ids.size(), &out[0]);
+  }
+
+private:
+  unsigned int m_packedId;
+};
+
+}
+#endif
@@ -0,0 +1,206 @@
+#ifndef idents_NarrowIds_h
+#define idents_NarrowIds_h
+
+#include "idents/TkrId.h"
+#include "idents/CalXtalId.h"
+#include "idents/AcdId.h"
+#include <vector>
+#include <iterator>
+#include <stdexcept>
+#include <cstddef>
+
+/**
+ * @file NarrowIds.h
+ *
+ * @brief Storage forms of TkrId, CalXtalId and AcdId holding just the
+ * bits their layouts use, for collections of millions of ids.
+ *
+ * TkrId keeps its 31 bits in an unsigned long (8 bytes on LP64),
+ * CalXtalId its 16 bits in an unsigned int, and AcdId its 12 bits in
+ * an unsigned int next to a virtual table pointer.  TkrId32,
+ * CalXtalId16 and AcdId16 are single 32- or 16-bit words, converting
+ * implicitly to and from the full classes.  Converting a full id with
+ * bits beyond the narrow word throws std::invalid_argument.
+ *
+ * NarrowIdVector stores narrow ids and hands out full ones.
+ * (AcdGapId is already a 16-bit word and needs no narrow form.)
+ */
+
+namespace idents {
+
+/// TkrId in 32 bits
+class TkrId32 {
+public:
+  typedef TkrId full_type;
+  typedef unsigned int word_type;
+
+  TkrId32() : m_word(0) {}
+  TkrId32(const TkrId& id) : m_word((word_type) id.m_packedId) {
+    if (id.m_packedId != m_word) {
+      throw std::invalid_argument("TkrId32: id does not fit 32 bits");
+    }
+  }
+
+  TkrId get() const {return TkrId::fromPackedId(m_word);}
+  operator TkrId() const {return get();}
+
+  word_type word() const {return m_word;}
+
+  bool operator==(const TkrId32& o) const {return m_word == o.m_word;}
+  bool operator!=(const TkrId32& o) const {return m_word != o.m_word;}
+  /// Same order as TkrId::operator<
+  bool operator<(const TkrId32& o) const {return m_word < o.m_word;}
+
+private:
+  word_type m_word;
+};
+
+/// CalXtalId in 16 bits
+class CalXtalId16 {
+public:
+  typedef CalXtalId full_type;
+  typedef unsigned short word_type;
+
+  CalXtalId16() : m_word(0) {}
+  CalXtalId16(const CalXtalId& id) : m_word((word_type) id.getPackedId()) {
+    if (id.getPackedId() != (int) m_word) {
+      throw std::invalid_argument("CalXtalId16: id does not fit 16 bits");
+    }
+  }
+
+  CalXtalId get() const {return CalXtalId((int) m_word);}
+  operator CalXtalId() const {return get();}
+
+  word_type word() const {return m_word;}
+
+  bool operator==(const CalXtalId16& o) const {return m_word == o.m_word;}
+  bool operator!=(const CalXtalId16& o) const {return m_word != o.m_word;}
+  bool operator<(const CalXtalId16& o) const {return m_word < o.m_word;}
+
+private:
+  word_type m_word;
+};
+
+/// AcdId in 16 bits
+class AcdId16 {
+public:
+  typedef AcdId full_type;
+  typedef unsigned short word_type;
+
+  AcdId16() : m_word(0) {}
+  AcdId16(const AcdId& id) : m_word((word_type) (unsigned int) id) {
+    if ((unsigned int) id != m_word) {
+      throw std::invalid_argument("AcdId16: id does not fit 16 bits");
+    }
+  }
+
+  AcdId get() const {return AcdId((unsigned int) m_word);}
+  operator AcdId() const {return get();}
+
+  word_type word() const {return m_word;}
+
+  bool operator==(const AcdId16& o) const {return m_word == o.m_word;}
+  bool operator!=(const AcdId16& o) const {return m_word != o.m_word;}
+  bool operator<(const AcdId16& o) const {return m_word < o.m_word;}
+
+private:
+  word_type m_word;
+};
+
+/**
+ * @class NarrowIdVector
+ *
+ * @brief Vector of ids stored as @a Narrow (TkrId32, CalXtalId16 or
+ * AcdId16) and read and written as Narrow::full_type.
+ *
+ * Elements are returned by value, so there are no references into the
+ * vector; set() replaces one.  Iterators are random access and yield
+ * full ids, for use with read-only algorithms.
+ */
+template <class Narrow>
+class NarrowIdVector {
+public:
+  typedef typename Narrow::full_type value_type;
+  typedef Narrow storage_type;
+
+  NarrowIdVector() {}
+
+  template <class It>
+  NarrowIdVector(It first, It last) {assign(first, last);}
+
+  /// Replace the contents with the ids of [first, last)
+  template <class It>
+  void assign(It first, It last) {
+    m_ids.clear();
+    for (; first != last; ++first) m_ids.push_back(Narrow(*first));
+  }
+
+  std::size_t size() const {return m_ids.size();}
+  bool empty() const {return m_ids.empty();}
+  void reserve(std::size_t n) {m_ids.reserve(n);}
+  void resize(std::size_t n) {m_ids.resize(n);}
+  void clear() {m_ids.clear();}
+
+  void push_back(const value_type& id) {m_ids.push_back(Narrow(id));}
+  void pop_back() {m_ids.pop_back();}
+
+  value_type operator[](std::size_t i) const {return m_ids[i].get();}
+  value_type at(std::size_t i) const {return m_ids.at(i).get();}
+  value_type front() const {return m_ids.front().get();}
+  value_type back() const {return m_ids.back().get();}
+
+  void set(std::size_t i, const value_type& id) {m_ids[i] = Narrow(id);}
+
+  /// The narrow ids themselves
+  const std::vector<Narrow>& storage() const {return m_ids;}
+  std::vector<Narrow>& storage() {return m_ids;}
+
+  class const_iterator {
+  public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef typename Narrow::full_type value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const value_type* pointer;
+    typedef value_type reference;
+
+    const_iterator() : m_p(0) {}
+    explicit const_iterator(const Narrow* p) : m_p(p) {}
+
+    value_type operator*() const {return m_p->get();}
+    value_type operator[](difference_type k) const {return m_p[k].get();}
+
+    const_iterator& operator++() {++m_p; return *this;}
+    const_iterator& operator--() {--m_p; return *this;}
+    const_iterator operator++(int) {const_iterator t(*this); ++m_p; return t;}
+    const_iterator operator--(int) {const_iterator t(*this); --m_p; return t;}
+    const_iterator& operator+=(difference_type k) {m_p += k; return *this;}
+    const_iterator& operator-=(difference_type k) {m_p -= k; return *this;}
+    const_iterator operator+(difference_type k) const {
+      return const_iterator(m_p + k);
+    }
+    const_iterator operator-(difference_type k) const {
+      return const_iterator(m_p - k);
+    }
+    difference_type operator-(const const_iterator& o) const {
+      return m_p - o.m_p;
+    }
+
+    bool operator==(const const_iterator& o) const {return m_p == o.m_p;}
+    bool operator!=(const const_iterator& o) const {return m_p != o.m_p;}
+    bool operator<(const const_iterator& o) const {return m_p < o.m_p;}
+
+  private:
+    const Narrow* m_p;
+  };
+
+  const_iterator begin() const {
+    return const_iterator(m_ids.empty() ? 0 : &m_ids[0]);
+  }
+  const_iterator end() const {return begin() + size();}
+
+private:
+  std::vector<Narrow> m_ids;
+};
+
+}
+#endif
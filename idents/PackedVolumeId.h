@@ -0,0 +1,117 @@
+#ifndef idents_PackedVolumeId_h
+#define idents_PackedVolumeId_h
+
+#include "idents/VolumeIdentifier.h"
+#include <string>
+#include <cstddef>
+
+namespace idents {
+
+/**
+ * @class PackedVolumeId
+ *
+ * @brief A VolumeIdentifier in a single 8-byte word, for large
+ * collections, sorting and hashing.
+ *
+ * VolumeIdentifier keeps its value and size in separate members and
+ * is padded to 16 bytes.  The value only uses its low 60 bits and the
+ * size is at most 10, so both fit in one word: the value shifted up by
+ * 4 bits, with the size in the low 4 bits.  This is
+ * VolumeIdentifier::packedKey().  With the size below the fields, one
+ * unsigned compare orders PackedVolumeIds exactly as operator< orders
+ * the identifiers: value first, then size.
+ *
+ * The read-only part of the VolumeIdentifier interface is provided;
+ * convert to VolumeIdentifier to build or modify an identifier.
+ */
+class PackedVolumeId {
+public:
+  typedef VolumeIdentifier::int64 int64;
+  typedef VolumeIdentifier::uint64 uint64;
+
+  PackedVolumeId() : m_key(0) {}
+  explicit PackedVolumeId(const VolumeIdentifier& id)
+    : m_key(id.packedKey()) {}
+
+  VolumeIdentifier volumeId() const {
+    return VolumeIdentifier::fromPackedKey(m_key);
+  }
+
+  /// The same as VolumeIdentifier::getValue()
+  int64 getValue() const {return (int64) (m_key >> 4);}
+
+  int size() const {return (int) (m_key & 0xf);}
+
+  /// Field @a index
+  unsigned int operator[](unsigned int index) const {
+    return (unsigned int) (m_key >> (VolumeIdentifier::fieldShift(index) + 4))
+      & VolumeIdentifier::maxFieldValue();
+  }
+
+  std::string name(const char* delimiter = "/") const {
+    return volumeId().name(delimiter);
+  }
+
+  typedef VolumeIdentifier::SubsystemSelect SubsystemSelect;
+  bool isTkr(const SubsystemSelect& sel = 
+             VolumeIdentifier::builtinSelect()) const {
+    return volumeId().isTkr(sel);
+  }
+  bool isCal(const SubsystemSelect& sel = 
+             VolumeIdentifier::builtinSelect()) const {
+    return volumeId().isCal(sel);
+  }
+  bool isAcd(const SubsystemSelect& sel = 
+             VolumeIdentifier::builtinSelect()) const {
+    return volumeId().isAcd(sel);
+  }
+  VolumeIdentifier::Subsystem classify(const SubsystemSelect& sel = 
+                                       VolumeIdentifier::builtinSelect()) const {
+    return volumeId().classify(sel);
+  }
+
+  /// true if this identifier is @a prefix or lies beneath it
+  bool isDescendantOf(const PackedVolumeId& prefix) const {
+    return (size() >= prefix.size()) &&
+      ((((m_key ^ prefix.m_key) >> 4) &
+        (uint64) VolumeIdentifier::prefixMask(prefix.size())) == 0);
+  }
+
+  uint64 packedKey() const {return m_key;}
+  static PackedVolumeId fromPackedKey(uint64 key) {
+    PackedVolumeId id;
+    id.m_key = key;
+    return id;
+  }
+
+  bool operator<(const PackedVolumeId& o) const {return m_key < o.m_key;}
+  bool operator==(const PackedVolumeId& o) const {return m_key == o.m_key;}
+  bool operator!=(const PackedVolumeId& o) const {return m_key != o.m_key;}
+
+private:
+  uint64 m_key;
+};
+
+#if __cplusplus >= 201103L
+static_assert(sizeof(PackedVolumeId) == 8, "PackedVolumeId is not one word");
+#endif
+
+/// Hash function object for PackedVolumeId; agrees with
+/// VolumeIdentifierHash for the same identifier
+struct PackedVolumeIdHash {
+  std::size_t operator()(const PackedVolumeId& id) const {
+    return VolumeIdentifierHash::mix(id.packedKey());
+  }
+};
+
+}
+
+#if __cplusplus >= 201103L
+#include <functional>
+namespace std {
+  template <> struct hash<idents::PackedVolumeId>
+    : public idents::PackedVolumeIdHash {};
+}
+#endif
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef idents_SimdLevel_h
+#define idents_SimdLevel_h
+
+namespace idents {
+
+/**
+ * @class SimdLevel
+ *
+ * @brief Which vector instructions the batch operations (VolumeIdColumns,
+ * countSubsystems(), filterDescendants(), the sorted set operations,
+ * TkrIdColumns, TkrId::build() and findStripRuns()) use.
+ *
+ * Their AVX2 and AVX-512 kernels are compiled into every x86-64 build
+ * of the package; the one used is chosen when the program starts, from
+ * what the processor and operating system support.  Elsewhere only
+ * the portable code exists and the level is always eScalar.  use()
+ * lowers the level, to compare or time the kernels.
+ */
+class SimdLevel {
+public:
+  enum Level {
+    eScalar = 0,
+    eAvx2,
+    eAvx512
+  };
+
+  /// Level in use
+  static Level current() {return s_level;}
+
+  /// Highest level the processor supports and the package has kernels for
+  static Level detected();
+
+  /// Use @a level, or detected() if that is lower; returns the level now
+  /// in use
+  static Level use(Level level);
+
+private:
+  static Level s_level;
+};
+
+}
+#endif
@@ -3,6 +3,7 @@
 
 #include <stdexcept>
 #include <iostream>
+#include <cstddef>
 
 namespace idents {
     
@@ -19,8 +20,11 @@ namespace idents {
 * $Header: /nfs/slac/g/glast/ground/cvs/idents/idents/TkrId.h,v 1.11 2005/01/03 07:02:12 lsrea Exp $
 */
   class VolumeIdentifier;
+  class BitFieldLayout;
 
   class TkrId {
+    friend class TkrIdColumns;
+    friend class TkrId32;
   public:
 
     /** constructor from VolumeIdentifier.  Throws std::invalid_argument
@@ -30,6 +34,14 @@ namespace idents {
         and nesting of volumes in xml geometry description
     */
     TkrId(const VolumeIdentifier& vId);
+
+    /** Convert @a n VolumeIdentifiers at once, without exceptions.
+        out[i] is what TkrId(vIds[i]) gives, bit for bit, and valid[i]
+        is 1, where that constructor would succeed; otherwise out[i] is
+        TkrId() and valid[i] is 0.  Returns the number converted.
+    */
+    static std::size_t build(const VolumeIdentifier* vIds, std::size_t n,
+                             TkrId* out, unsigned char* valid);
     /** constructor including just enough information to identify 
         silicon plane (view optional)     */
     TkrId(unsigned towerX, unsigned towerY, unsigned tray, bool top, 
@@ -46,6 +58,14 @@ namespace idents {
     }
 
     const bool operator<(const TkrId& right) const {return m_packedId < right.m_packedId;}
+
+    /// The packed word; fields and validity bits take the low 31 bits
+    unsigned int getPackedId() const {return (unsigned int) m_packedId;}
+    static TkrId fromPackedId(unsigned int packedId) {
+      TkrId id;
+      id.m_packedId = packedId;
+      return id;
+    }
     
     /** Identify top or bottom Silicon layer.
         Should have same values as identically-named constants in xml 
@@ -126,12 +146,24 @@ namespace idents {
       if (!(hasTowerX())) throw std::domain_error("No TowerX field");
       return (m_packedId & SHMASKTowerX) >> SHIFTTowerX;
     }
+    /// As getTowerX(), but returns false instead of throwing
+    bool getTowerX(unsigned int& towerX) const {
+      if (!(hasTowerX())) return false;
+      towerX = (m_packedId & SHMASKTowerX) >> SHIFTTowerX;
+      return true;
+    }
 
     bool hasTowerY() const {return ((m_packedId & VALIDTowerY) != 0);}
     unsigned int getTowerY() const  {
       if (!(hasTowerY())) throw std::domain_error("No TowerY field");
       return (m_packedId & SHMASKTowerY) >> SHIFTTowerY;
     }
+    /// As getTowerY(), but returns false instead of throwing
+    bool getTowerY(unsigned int& towerY) const {
+      if (!(hasTowerY())) return false;
+      towerY = (m_packedId & SHMASKTowerY) >> SHIFTTowerY;
+      return true;
+    }
 
 
     bool hasTray() const {return ((m_packedId & VALIDTray) != 0);}
@@ -139,6 +171,12 @@ namespace idents {
       if (!(hasTray())) throw std::domain_error("No Tray field");
       return (m_packedId & SHMASKTray) >> SHIFTTray;
     }
+    /// As getTray(), but returns false instead of throwing
+    bool getTray(unsigned int& tray) const {
+      if (!(hasTray())) return false;
+      tray = (m_packedId & SHMASKTray) >> SHIFTTray;
+      return true;
+    }
 
 
     bool hasBotTop() const {return ((m_packedId & VALIDBotTop) != 0);}
@@ -146,6 +184,12 @@ namespace idents {
       if (!(hasBotTop())) throw std::domain_error("No BotTop field");
       return (m_packedId & SHMASKBotTop) >> SHIFTBotTop;
     }
+    /// As getBotTop(), but returns false instead of throwing
+    bool getBotTop(unsigned int& botTop) const {
+      if (!(hasBotTop())) return false;
+      botTop = (m_packedId & SHMASKBotTop) >> SHIFTBotTop;
+      return true;
+    }
 
 
     bool hasView() const {return ((m_packedId & VALIDMeas) != 0);}
@@ -156,6 +200,12 @@ namespace idents {
       //    <<((m_packedId & SHMASKMeas) >> SHIFTMeas) << std::endl;
      return (m_packedId & SHMASKMeas) >> SHIFTMeas;
     }
+    /// As getView(), but returns false instead of throwing
+    bool getView(unsigned int& view) const {
+      if (!(hasView())) return false;
+      view = (m_packedId & SHMASKMeas) >> SHIFTMeas;
+      return true;
+    }
 
 
     bool hasLadder() const {return ((m_packedId & VALIDLadder) != 0);}
@@ -163,6 +213,12 @@ namespace idents {
       if (!(hasLadder())) throw std::domain_error("No Ladder field");
       return (m_packedId & SHMASKLadder) >> SHIFTLadder;
     }
+    /// As getLadder(), but returns false instead of throwing
+    bool getLadder(unsigned int& ladder) const {
+      if (!(hasLadder())) return false;
+      ladder = (m_packedId & SHMASKLadder) >> SHIFTLadder;
+      return true;
+    }
 
     
     bool hasWafer() const {return ((m_packedId & VALIDWafer) != 0);}
@@ -170,6 +226,40 @@ namespace idents {
       if (!(hasWafer())) throw std::domain_error("No Wafer field");
       return (m_packedId & SHMASKWafer) >> SHIFTWafer;
     }
+    /// As getWafer(), but returns false instead of throwing
+    bool getWafer(unsigned int& wafer) const {
+      if (!(hasWafer())) return false;
+      wafer = (m_packedId & SHMASKWafer) >> SHIFTWafer;
+      return true;
+    }
+
+    /// Positions in the arrays used by unpack() and pack(); fields
+    /// are in the order they occupy in the packed word
+    enum {
+      eTowerYField = 0,
+      eTowerXField,
+      eTrayField,
+      eViewField,
+      eBotTopField,
+      eLadderField,
+      eWaferField,
+      eNumFields
+    };
+
+    /** All fields at once, to @a fields[eTowerYField] through
+        @a fields[eWaferField].  Fields which are not valid (see 
+        hasTowerX() etc.) read as 0.  If @a valid is given, valid[k]
+        is set to 1 if field k is valid, 0 if not. */
+    void unpack(unsigned char* fields, unsigned char* valid = 0) const;
+
+    /** Set all fields from @a fields, in the order of unpack(), each
+        cut to its width.  With no @a valid every field is marked
+        valid, so pack() of what unpack() gave differs from the
+        original id if that lacked any field; pass the @a valid array
+        from unpack() (1 for a valid field, 0 for one which is not) to
+        keep the same fields valid.  Fields which are not valid are
+        packed as 0. */
+    void pack(const unsigned char* fields, const unsigned char* valid = 0);
 
     //Access Methods for Tkr reconstruction semantics:
     //unsigned int getLayer() const {return ( getPlane())/2;}
@@ -203,7 +293,18 @@ namespace idents {
 
     /// Does the actual work; extracted here since gcc doesn't let
     /// debugger see symbols
-    void constructorGuts(const VolumeIdentifier& vId);      
+    void constructorGuts(const VolumeIdentifier& vId);
+
+    /// The packed word for @a vId into @a packed; false if @a vId is
+    /// not a valid tkr identifier
+    static bool packVolumeId(const VolumeIdentifier& vId,
+                             unsigned long& packed);
+
+    /// Positions of the fields, in the order of unpack()
+    static const BitFieldLayout& layout();
+
+    /// Positions of the VALID bits, in the same order
+    static const BitFieldLayout& validLayout();
 
     /// Bitmask containing tracker information
     //    unsigned short int m_packedId;
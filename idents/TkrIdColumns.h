@@ -0,0 +1,63 @@
+#ifndef idents_TkrIdColumns_h
+#define idents_TkrIdColumns_h
+
+#include "idents/TkrId.h"
+#include <vector>
+#include <cstddef>
+
+namespace idents {
+
+/** 
+ * @class TkrIdColumns
+ *
+ * @brief Struct-of-arrays decoding of a batch of TkrIds, with no
+ * exceptions for missing fields.
+ *
+ * decode() extracts every field of every TkrId in one pass.  Column k
+ * holds field k, numbered as for TkrId::unpack() (TkrId::eTowerYField
+ * through TkrId::eWaferField), 0 where the field is not valid.  The
+ * valid() column holds one byte per TkrId with bit validBit(k) set if
+ * field k is valid.
+ *
+ * Uses AVX-512 or AVX2 kernels where the processor has them (see
+ * SimdLevel) and TkrId is a 64-bit word, otherwise portable code.
+ */
+class TkrIdColumns {
+public:
+  enum { nFields = TkrId::eNumFields };
+
+  TkrIdColumns() : m_count(0) {}
+
+  /// Decode @a n TkrIds.  Storage from earlier calls is reused.
+  void decode(const TkrId* ids, std::size_t n);
+
+  void decode(const std::vector<TkrId>& ids) {
+    decode(ids.empty() ? 0 : &ids[0], ids.size());
+  }
+
+  /// Number of TkrIds decoded by last call to decode()
+  std::size_t count() const {return m_count;}
+
+  /// Column of values of field @a k, 0 <= k < nFields; null if
+  /// count() is 0
+  const unsigned char* field(unsigned k) const {
+    return m_columns.empty() ? 0 : &m_columns[0] + k * m_count;
+  }
+
+  /// Column of validity masks; null if count() is 0
+  const unsigned char* valid() const {
+    return m_columns.empty() ? 0 : &m_columns[0] + nFields * m_count;
+  }
+
+  /// Bit of the validity mask for field @a k
+  static unsigned validBit(unsigned k) {return 1u << (nFields - 1 - k);}
+
+private:
+  /// nFields field columns followed by the validity column, each
+  /// m_count long
+  std::vector<unsigned char> m_columns;
+  std::size_t m_count;
+};
+
+}
+#endif
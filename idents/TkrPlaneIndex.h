@@ -0,0 +1,105 @@
+#ifndef idents_TkrPlaneIndex_h
+#define idents_TkrPlaneIndex_h
+
+#include "idents/TkrId.h"
+#include "idents/TowerId.h"
+#include <vector>
+#include <cstddef>
+
+namespace idents {
+
+/**
+ * @class TkrPlaneIndex
+ *
+ * @brief Dense numbering 0..size()-1 of the tracker silicon planes,
+ * (tower, tray, botTop, view), with neighbour tables, so per-plane
+ * state can live in flat arrays indexed by plane.
+ *
+ * Plane numbers are ((tower * nTrays() + tray) * 2 + botTop) * 2 + view,
+ * tower being TowerId::id(), so within a tower and view the planes run
+ * upwards in z: the bottom of a tray, its top, the bottom of the next
+ * tray.  Conversion either way is arithmetic; the neighbour tables
+ * are filled by the constructor.
+ *
+ * Every combination of the four fields is numbered, whichever views
+ * the trays of the real detector carry.
+ */
+class TkrPlaneIndex {
+public:
+  /// Returned for no plane
+  enum { npos = ~0u };
+
+  enum { nTowers = TowerId::xNum * TowerId::yNum, defaultTrays = 19 };
+
+  explicit TkrPlaneIndex(unsigned nTrays = defaultTrays);
+
+  /// Number of planes
+  unsigned size() const {return m_size;}
+
+  unsigned nTrays() const {return m_nTrays;}
+
+  /// Plane of the given fields, with @a botTop and @a view 0 or 1;
+  /// npos if any is out of range
+  unsigned index(const TowerId& tower, unsigned tray, unsigned botTop,
+                 unsigned view) const {
+    if (((unsigned) tower.id() >= (unsigned) nTowers) ||
+        (tray >= m_nTrays) || (botTop > 1) || (view > 1)) {
+      return npos;
+    }
+    return ((tower.id() * m_nTrays + tray) * 2 + botTop) * 2 + view;
+  }
+
+  /// Plane of @a id, or npos if @a id lacks a tower, tray, botTop or
+  /// view field or the tray is beyond nTrays()
+  unsigned index(const TkrId& id) const;
+
+  TowerId tower(unsigned plane) const {return TowerId(plane / m_towerPlanes);}
+  unsigned tray(unsigned plane) const {
+    return (plane % m_towerPlanes) >> 2;
+  }
+  unsigned botTop(unsigned plane) const {return (plane >> 1) & 1;}
+  unsigned view(unsigned plane) const {return plane & 1;}
+
+  /// TkrId of @a plane, with tower, tray, botTop and view valid
+  TkrId tkrId(unsigned plane) const {
+    const TowerId t = tower(plane);
+    return TkrId(t.ix(), t.iy(), tray(plane), botTop(plane) != 0,
+                 view(plane));
+  }
+
+  /// Next plane up in the same tower and view, or npos at the top
+  unsigned above(unsigned plane) const {return m_above[plane];}
+
+  /// Next plane down in the same tower and view, or npos at the bottom
+  unsigned below(unsigned plane) const {return m_below[plane];}
+
+  /// Plane of the same tower, tray and botTop measuring the other view
+  unsigned otherView(unsigned plane) const {return m_otherView[plane];}
+
+  /// Number of planes in the same place in neighbouring towers (those
+  /// for which TowerId::neighbor() holds, less the tower itself)
+  unsigned nNeighbors(unsigned plane) const {
+    return m_firstNeighbor[plane + 1] - m_firstNeighbor[plane];
+  }
+
+  /// The nNeighbors(@a plane) neighbouring planes, in tower order
+  const unsigned* neighbors(unsigned plane) const {
+    return &m_neighbors[0] + m_firstNeighbor[plane];
+  }
+
+private:
+  unsigned m_nTrays;
+  /// Planes per tower, 4 * m_nTrays
+  unsigned m_towerPlanes;
+  unsigned m_size;
+  std::vector<unsigned> m_above;
+  std::vector<unsigned> m_below;
+  std::vector<unsigned> m_otherView;
+  /// Neighbours of plane p are m_neighbors[m_firstNeighbor[p]] up to
+  /// m_neighbors[m_firstNeighbor[p + 1]]
+  std::vector<unsigned> m_firstNeighbor;
+  std::vector<unsigned> m_neighbors;
+};
+
+}
+#endif
@@ -0,0 +1,119 @@
+#ifndef idents_TkrStripId_h
+#define idents_TkrStripId_h
+
+#include "idents/TkrId.h"
+#include "idents/TowerId.h"
+#include <vector>
+#include <cstddef>
+
+namespace idents {
+
+class TkrPlaneIndex;
+
+/**
+ * @class TkrStripId
+ *
+ * @brief One silicon strip of the tracker (tower, tray, botTop, view
+ * and strip number) in a 32-bit word, usable as a single sort key.
+ *
+ * Fields are packed from the top down in the order
+ * tower (4 bits) | tray (5) | botTop (1) | view (1) | strip (11),
+ * so ids sort by plane in TkrPlaneIndex order and then by strip, and
+ * neighbouring strips of a plane are consecutive integers.
+ */
+class TkrStripId {
+public:
+  typedef unsigned int uint32;
+
+  enum {
+    SHIFTStrip  = 0,
+    SHIFTView   = 11,
+    SHIFTBotTop = 12,
+    SHIFTTray   = 13,
+    SHIFTTower  = 18
+  };
+
+  enum {
+    MASKStrip  = 0x7ff,
+    MASKView   = 0x1,
+    MASKBotTop = 0x1,
+    MASKTray   = 0x1f,
+    MASKTower  = 0xf
+  };
+
+  TkrStripId() : m_word(0) {}
+
+  /// From a word made by word()
+  explicit TkrStripId(uint32 word) : m_word(word) {}
+
+  /// Throws std::invalid_argument if a field does not fit its bits
+  TkrStripId(const TowerId& tower, unsigned tray, unsigned botTop,
+             unsigned view, unsigned strip);
+
+  /// Strip @a strip of the plane of @a plane, which must have tower,
+  /// tray, botTop and view fields; throws std::invalid_argument if not
+  TkrStripId(const TkrId& plane, unsigned strip);
+
+  uint32 word() const {return m_word;}
+
+  TowerId getTower() const {
+    return TowerId((m_word >> SHIFTTower) & MASKTower);
+  }
+  unsigned getTray() const {return (m_word >> SHIFTTray) & MASKTray;}
+  unsigned getBotTop() const {return (m_word >> SHIFTBotTop) & MASKBotTop;}
+  unsigned getView() const {return (m_word >> SHIFTView) & MASKView;}
+  unsigned getStrip() const {return (m_word >> SHIFTStrip) & MASKStrip;}
+
+  /// The plane as a TkrId, with tower, tray, botTop and view valid
+  TkrId getTkrId() const {
+    const TowerId tower = getTower();
+    return TkrId(tower.ix(), tower.iy(), getTray(), getBotTop() != 0,
+                 getView());
+  }
+
+  /// Equal for strips of the same plane, ordered as the planes
+  uint32 planeKey() const {return m_word >> SHIFTView;}
+
+  bool samePlane(const TkrStripId& other) const {
+    return planeKey() == other.planeKey();
+  }
+
+  bool operator==(const TkrStripId& o) const {return m_word == o.m_word;}
+  bool operator!=(const TkrStripId& o) const {return m_word != o.m_word;}
+  bool operator<(const TkrStripId& o) const {return m_word < o.m_word;}
+
+private:
+  uint32 m_word;
+};
+
+/// Contiguous strips of one plane: positions [begin, end) of a sorted
+/// array of TkrStripIds
+struct TkrStripRun {
+  std::size_t begin;
+  std::size_t end;
+};
+
+/// Sort @a n strip ids, into the same order std::sort would give
+void radixSort(TkrStripId* ids, std::size_t n);
+void radixSort(std::vector<TkrStripId>& ids);
+
+/**
+ * Split @a n sorted strip ids into runs of neighbouring strips of the
+ * same plane, replacing the contents of @a runs; repeated ids stay in
+ * one run.  Returns the number of runs.  Throws std::invalid_argument
+ * if @a ids is not sorted.
+ */
+std::size_t findStripRuns(const TkrStripId* ids, std::size_t n,
+                          std::vector<TkrStripRun>& runs);
+
+/**
+ * Count @a n strip ids (in any order) by plane of @a planes, into
+ * @a counts, which is resized to planes.size().  Returns the number
+ * of ids whose tray is beyond planes.nTrays(), which are not counted.
+ */
+std::size_t countStripsPerPlane(const TkrStripId* ids, std::size_t n,
+                                const TkrPlaneIndex& planes,
+                                std::vector<unsigned>& counts);
+
+}
+#endif
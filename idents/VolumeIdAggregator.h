@@ -0,0 +1,90 @@
+#ifndef idents_VolumeIdAggregator_h
+#define idents_VolumeIdAggregator_h
+
+#include "idents/VolumeIdentifier.h"
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+namespace idents {
+
+/**
+ * @class VolumeIdAggregator
+ *
+ * @brief Sums, counts, minima and maxima of values attached to
+ * identifiers, rolled up to several levels of the geometry hierarchy
+ * in one pass.
+ *
+ * The level at depth d groups identifiers by their first d fields:
+ * for the tracker, depth 9 is the wafer, 8 the ladder, 7 the plane,
+ * 5 the tray and 3 the tower.  Identifiers with fewer than d fields
+ * belong to no group at that depth.
+ *
+ * Input must be sorted (repeated identifiers are allowed).  Fields are
+ * packed most significant first, so the identifiers of each group are
+ * contiguous and a group ends where the value, masked to the group's
+ * fields, changes.  run() tests that once per element for each
+ * requested depth.
+ */
+class VolumeIdAggregator {
+public:
+  /// Totals for the identifiers under one prefix
+  struct Group {
+    /// The first depth fields shared by the group's identifiers
+    VolumeIdentifier prefix;
+    std::size_t count;
+    double sum;
+    double min;
+    double max;
+
+    double mean() const {return sum / count;}
+  };
+
+  /**
+   * Aggregate at each of the @a n depths in @a depths, each at most
+   * VolumeIdentifier::maxSize().  Throws std::invalid_argument
+   * otherwise.
+   */
+  VolumeIdAggregator(const unsigned* depths, unsigned n);
+
+  explicit VolumeIdAggregator(const std::vector<unsigned>& depths);
+
+  /**
+   * Aggregate @a n values, @a values[i] belonging to @a ids[i].
+   * @a ids must be sorted; throws std::invalid_argument if not.
+   * Replaces the results of earlier calls, reusing their storage.
+   */
+  void run(const VolumeIdentifier* ids, const double* values, std::size_t n);
+
+  /// As above, for (identifier, value) pairs
+  void run(const std::vector<std::pair<VolumeIdentifier, double> >& data);
+
+  /// Number of depths requested
+  unsigned nLevels() const {return m_levels.size();}
+
+  /// Depth of level @a k, in the order given to the constructor
+  unsigned depth(unsigned k) const {return m_levels[k].depth;}
+
+  /// Groups of level @a k, in identifier order
+  const std::vector<Group>& groups(unsigned k) const {
+    return m_levels[k].groups;
+  }
+
+private:
+  void init(const unsigned* depths, unsigned n);
+
+  /// Add @a x, belonging to @a id, to its group at each level
+  void add(const VolumeIdentifier& id, double x);
+
+  /// A requested depth and its groups so far
+  struct Level {
+    unsigned depth;
+    VolumeIdentifier::int64 mask;
+    std::vector<Group> groups;
+  };
+
+  std::vector<Level> m_levels;
+};
+
+}
+#endif
@@ -0,0 +1,122 @@
+#ifndef idents_VolumeIdAlgorithms_h
+#define idents_VolumeIdAlgorithms_h
+
+#include "idents/VolumeIdentifier.h"
+#include "idents/BitOps.h"
+#include <algorithm>
+#include <cstddef>
+
+/**
+ * @file VolumeIdAlgorithms.h
+ *
+ * @brief Algorithms on arrays of VolumeIdentifiers.
+ *
+ * Fields are packed most significant first, so sorting identifiers
+ * groups each subtree of the geometry into one contiguous range.  The
+ * bounds of that range are found with two binary searches, and two
+ * sorted arrays can be joined in one merge pass.
+ */
+
+namespace idents {
+
+  /// First element of sorted [first, last) which is under @a prefix
+  /// (if there is one; in any case the start of the subtree range)
+  template <class It>
+  It prefixLowerBound(It first, It last, const VolumeIdentifier& prefix) {
+    return std::lower_bound(first, last, prefix);
+  }
+
+  /// End of the range of elements of sorted [first, last) which are
+  /// under @a prefix
+  template <class It>
+  It prefixUpperBound(It first, It last, const VolumeIdentifier& prefix) {
+    // Largest possible descendant: all remaining bits set, maximum size
+    VolumeIdentifier limit;
+    limit.init(prefix.getValue() | 
+               (VolumeIdentifier::prefixMask(VolumeIdentifier::maxSize()) &
+                ~VolumeIdentifier::prefixMask(prefix.size())),
+               VolumeIdentifier::maxSize());
+    return std::upper_bound(first, last, limit);
+  }
+
+  /**
+   * Copy the identifiers of @a ids which are under @a prefix to 
+   * @a out, preserving order, and return how many there were.
+   * @a out may be the same as @a ids.
+   */
+  std::size_t filterDescendants(const VolumeIdentifier* ids, std::size_t n,
+                                const VolumeIdentifier& prefix,
+                                VolumeIdentifier* out);
+
+  /**
+   * Number of leading fields @a a and @a b have in common, at most the
+   * size of the shorter.  Fields are packed most significant first, so
+   * this is found from the leading zeros of the XOR of the values.
+   */
+  inline unsigned commonPrefixDepth(const VolumeIdentifier& a,
+                                    const VolumeIdentifier& b) {
+    // The top 4 bits of the value are never used
+    const bitops::uint64 diff = a.getValue() ^ b.getValue();
+    unsigned depth = diff ? (bitops::clz64(diff) - 4) / 6
+                          : VolumeIdentifier::maxSize();
+    depth = std::min(depth, (unsigned) a.size());
+    return std::min(depth, (unsigned) b.size());
+  }
+
+  /**
+   * Copy the identifiers which are in both sorted, duplicate-free
+   * arrays @a a and @a b to @a out, in order, and return how many
+   * there were.  @a out may be the same as @a a.
+   */
+  std::size_t intersectSorted(const VolumeIdentifier* a, std::size_t na,
+                              const VolumeIdentifier* b, std::size_t nb,
+                              VolumeIdentifier* out);
+
+  /**
+   * Copy the identifiers of sorted, duplicate-free @a a which are not
+   * in sorted, duplicate-free @a b to @a out, in order, and return how
+   * many there were.  @a out may be the same as @a a.
+   */
+  std::size_t differenceSorted(const VolumeIdentifier* a, std::size_t na,
+                               const VolumeIdentifier* b, std::size_t nb,
+                               VolumeIdentifier* out);
+
+  /// Key extractor for mergeJoin(): the @c first member of a pair
+  struct FirstOf {
+    template <class P>
+    const VolumeIdentifier& operator()(const P& p) const {return p.first;}
+  };
+
+  /**
+   * Join two ranges of records sorted by identifier, calling 
+   * @a join(ra, rb) for every record @a ra of [a, aEnd) and @a rb of
+   * [b, bEnd) whose identifiers, @a keyA(ra) and @a keyB(rb), are 
+   * equal.  Identifiers may repeat; each run of equal identifiers in
+   * one range is paired with every record of the matching run in the
+   * other.  Returns the number of calls made.
+   */
+  template <class ItA, class ItB, class KeyA, class KeyB, class Join>
+  std::size_t mergeJoin(ItA a, ItA aEnd, ItB b, ItB bEnd,
+                        KeyA keyA, KeyB keyB, Join join) {
+    std::size_t calls = 0;
+    while ((a != aEnd) && (b != bEnd)) {
+      const VolumeIdentifier::uint64 ka = keyA(*a).packedKey();
+      const VolumeIdentifier::uint64 kb = keyB(*b).packedKey();
+      if (ka < kb) ++a;
+      else if (kb < ka) ++b;
+      else {
+        ItB runEnd = b;
+        do ++runEnd; 
+        while ((runEnd != bEnd) && (keyB(*runEnd).packedKey() == ka));
+        do {
+          for (ItB rb = b; rb != runEnd; ++rb, ++calls) join(*a, *rb);
+          ++a;
+        } while ((a != aEnd) && (keyA(*a).packedKey() == ka));
+        b = runEnd;
+      }
+    }
+    return calls;
+  }
+
+}
+#endif
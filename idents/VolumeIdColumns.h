@@ -0,0 +1,58 @@
+#ifndef idents_VolumeIdColumns_h
+#define idents_VolumeIdColumns_h
+
+#include "idents/VolumeIdentifier.h"
+#include <vector>
+#include <cstddef>
+
+namespace idents {
+
+/** 
+ * @class VolumeIdColumns
+ *
+ * @brief Struct-of-arrays decoding of a batch of VolumeIdentifiers.
+ *
+ * decode() unpacks every field of every identifier in one pass, so
+ * code which needs the same field of many identifiers can work on a
+ * column of bytes rather than calling operator[] per identifier.
+ * Column i holds field i (0 for fields beyond an identifier's size);
+ * sizes() holds the size of each identifier.
+ *
+ * Uses AVX-512 or AVX2 kernels where the processor has them (see
+ * SimdLevel), otherwise portable code.
+ */
+class VolumeIdColumns {
+public:
+  enum { nFields = 10 };
+
+  VolumeIdColumns() : m_count(0) {}
+
+  /// Decode @a n identifiers.  Storage from earlier calls is reused.
+  void decode(const VolumeIdentifier* ids, std::size_t n);
+
+  void decode(const std::vector<VolumeIdentifier>& ids) {
+    decode(ids.empty() ? 0 : &ids[0], ids.size());
+  }
+
+  /// Number of identifiers decoded by last call to decode()
+  std::size_t count() const {return m_count;}
+
+  /// Column of values of field @a i, 0 <= i < nFields; null if
+  /// count() is 0
+  const unsigned char* field(unsigned i) const {
+    return m_columns.empty() ? 0 : &m_columns[0] + i * m_count;
+  }
+
+  /// Column of identifier sizes; null if count() is 0
+  const unsigned char* sizes() const {
+    return m_columns.empty() ? 0 : &m_columns[0] + nFields * m_count;
+  }
+
+private:
+  /// nFields field columns followed by the size column, each m_count long
+  std::vector<unsigned char> m_columns;
+  std::size_t m_count;
+};
+
+}
+#endif
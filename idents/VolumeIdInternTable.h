@@ -0,0 +1,101 @@
+#ifndef idents_VolumeIdInternTable_h
+#define idents_VolumeIdInternTable_h
+
+#include "idents/VolumeIdentifier.h"
+#include <vector>
+#include <cstddef>
+
+namespace idents {
+
+/**
+ * @class VolumeIdInternTable
+ *
+ * @brief Dense numbering of a fixed set of VolumeIdentifiers, such as
+ * all sensitive volumes of the LAT, through a minimal perfect hash.
+ *
+ * build() is given the whole set once, at startup.  Afterwards index()
+ * maps each member to a distinct number in [0, size()), so per-volume
+ * state can be kept in flat arrays; volumeId() maps back.
+ *
+ * The hash is of the hash-and-displace kind: an identifier's hash
+ * picks a bucket, and the bucket's displacement, chosen at build time
+ * so that no two members collide, picks the slot.  A lookup is two
+ * multiplicative hashes, two loads and a compare with the key stored
+ * in the slot, which detects non-members; there are no branches.
+ * Numbering follows the hash, not the identifier order.
+ */
+class VolumeIdInternTable {
+public:
+  typedef VolumeIdentifier::uint64 uint64;
+
+  /// Returned by index() for identifiers not in the set
+  static const unsigned int notFound = 0xffffffff;
+
+  VolumeIdInternTable() { clear(); }
+
+  /// Build over the @a n identifiers in @a ids.  Throws
+  /// std::invalid_argument if an identifier appears twice.
+  void build(const VolumeIdentifier* ids, std::size_t n);
+
+  void build(const std::vector<VolumeIdentifier>& ids) {
+    build(ids.empty() ? 0 : &ids[0], ids.size());
+  }
+
+  void clear();
+
+  /// Number of identifiers in the set
+  std::size_t size() const {return m_size;}
+
+  /// Dense index of @a id, or notFound
+  unsigned int index(const VolumeIdentifier& id) const {
+    const uint64 key = id.packedKey();
+    const unsigned int slot = slotOf(key);
+    const unsigned int hit = 0u - (unsigned int) (m_keys[slot] == key);
+    return (slot & hit) | (notFound & ~hit);
+  }
+
+  bool contains(const VolumeIdentifier& id) const {
+    return index(id) != notFound;
+  }
+
+  /// Identifier with dense index @a i, which must be less than size()
+  VolumeIdentifier volumeId(unsigned int i) const {
+    return VolumeIdentifier::fromPackedKey(m_keys[i]);
+  }
+
+private:
+  /// Maps a 32-bit hash evenly onto [0, n) without a division
+  static unsigned int fastRange(uint64 hash32, unsigned int n) {
+    return (unsigned int) ((hash32 * n) >> 32);
+  }
+
+  unsigned int bucketOf(uint64 hash) const {
+    return fastRange(hash >> 32, m_nBuckets);
+  }
+
+  static unsigned int slotFor(uint64 hash, uint64 displace,
+                              unsigned int nSlots) {
+    return fastRange(((hash ^ displace) * 0x9e3779b97f4a7c15ULL) >> 32,
+                     nSlots);
+  }
+
+  unsigned int slotOf(uint64 key) const {
+    const uint64 hash = VolumeIdentifierHash::mix(key ^ m_seed);
+    return slotFor(hash, m_displace[bucketOf(hash)], m_nSlots);
+  }
+
+  /// Try to place all keys with hash seed @a seed
+  bool place(const std::vector<uint64>& keys, uint64 seed);
+
+  /// Key in each slot; never a valid packed key in an empty table
+  std::vector<uint64> m_keys;
+  /// Displacement of each bucket
+  std::vector<uint64> m_displace;
+  uint64 m_seed;
+  unsigned int m_nBuckets;
+  unsigned int m_nSlots;
+  std::size_t m_size;
+};
+
+}
+#endif
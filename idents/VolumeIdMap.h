@@ -0,0 +1,185 @@
+#ifndef idents_VolumeIdMap_h
+#define idents_VolumeIdMap_h
+
+#include "idents/VolumeIdentifier.h"
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cstddef>
+
+namespace idents {
+
+/**
+ * @class VolumeIdMap
+ *
+ * @brief Hash map from VolumeIdentifier to T using open addressing.
+ *
+ * Keys are stored as VolumeIdentifier::packedKey() in one flat array,
+ * values in a parallel array, with linear probing.  A lookup is a hash
+ * and usually one or two adjacent slots; no per-entry allocation is
+ * done.  clear() keeps the storage, so a map reserve()d once can be
+ * refilled every event without allocating.  The table is kept at most
+ * half full.
+ *
+ * Inserting may move existing entries, invalidating pointers to values
+ * and iterators.  Iteration order is unspecified.
+ */
+template <class T>
+class VolumeIdMap {
+public:
+  typedef VolumeIdentifier::uint64 key_type;
+  typedef T mapped_type;
+
+  VolumeIdMap() : m_size(0) {}
+  explicit VolumeIdMap(std::size_t n) : m_size(0) { reserve(n); }
+
+  /// Make room for @a n entries without further allocation
+  void reserve(std::size_t n) {
+    std::size_t cap = 16;
+    while (cap < 2 * n) cap *= 2;
+    if (cap > m_keys.size()) rehash(cap);
+  }
+
+  /// Remove all entries; storage is kept
+  void clear() {
+    if (m_size == 0) return;
+    std::fill(m_keys.begin(), m_keys.end(), s_empty);
+    m_size = 0;
+  }
+
+  std::size_t size() const {return m_size;}
+  bool empty() const {return m_size == 0;}
+  std::size_t capacity() const {return m_keys.size() / 2;}
+
+  /// Value for @a id, or null if not present
+  T* find(const VolumeIdentifier& id) {
+    std::size_t slot = locate(id.packedKey());
+    if (m_keys.empty() || (m_keys[slot] == s_empty)) return 0;
+    return &m_values[slot];
+  }
+  const T* find(const VolumeIdentifier& id) const {
+    std::size_t slot = locate(id.packedKey());
+    if (m_keys.empty() || (m_keys[slot] == s_empty)) return 0;
+    return &m_values[slot];
+  }
+
+  bool contains(const VolumeIdentifier& id) const {return find(id) != 0;}
+
+  /**
+   * Insert (@a id, @a value) unless @a id is already present.  Returns
+   * the value stored for @a id and whether an insertion was made.
+   */
+  std::pair<T*, bool> insert(const VolumeIdentifier& id, const T& value) {
+    key_type key = id.packedKey();
+    if (2 * (m_size + 1) > m_keys.size()) reserve(m_size + 1);
+    std::size_t slot = locate(key);
+    if (m_keys[slot] != s_empty) {
+      return std::make_pair(&m_values[slot], false);
+    }
+    m_keys[slot] = key;
+    m_values[slot] = value;
+    ++m_size;
+    return std::make_pair(&m_values[slot], true);
+  }
+
+  /// Value for @a id, default-constructed and inserted if not present
+  T& operator[](const VolumeIdentifier& id) {
+    return *insert(id, T()).first;
+  }
+
+  /// Remove @a id; returns false if it was not present
+  bool erase(const VolumeIdentifier& id) {
+    if (m_keys.empty()) return false;
+    std::size_t hole = locate(id.packedKey());
+    if (m_keys[hole] == s_empty) return false;
+
+    // Backward-shift deletion: move up any later entry in the probe
+    // run whose home slot is not cyclically within (hole, j]
+    const std::size_t mask = m_keys.size() - 1;
+    for (std::size_t j = (hole + 1) & mask; m_keys[j] != s_empty;
+         j = (j + 1) & mask) {
+      std::size_t home = slotOf(m_keys[j]);
+      bool stays = (hole <= j) ? ((hole < home) && (home <= j))
+                               : ((hole < home) || (home <= j));
+      if (stays) continue;
+      m_keys[hole] = m_keys[j];
+      m_values[hole] = m_values[j];
+      hole = j;
+    }
+    m_keys[hole] = s_empty;
+    --m_size;
+    return true;
+  }
+
+  /// Forward iterator over entries, giving key() and value()
+  template <class Map, class V>
+  class Iterator {
+  public:
+    Iterator(Map* map, std::size_t slot) : m_map(map), m_slot(slot) {
+      skip();
+    }
+    VolumeIdentifier key() const {
+      return VolumeIdentifier::fromPackedKey(m_map->m_keys[m_slot]);
+    }
+    V& value() const {return m_map->m_values[m_slot];}
+    Iterator& operator++() {++m_slot; skip(); return *this;}
+    bool operator==(const Iterator& o) const {return m_slot == o.m_slot;}
+    bool operator!=(const Iterator& o) const {return m_slot != o.m_slot;}
+  private:
+    void skip() {
+      while ((m_slot < m_map->m_keys.size()) &&
+             (m_map->m_keys[m_slot] == s_empty)) ++m_slot;
+    }
+    Map* m_map;
+    std::size_t m_slot;
+  };
+  typedef Iterator<VolumeIdMap, T> iterator;
+  typedef Iterator<const VolumeIdMap, const T> const_iterator;
+
+  iterator begin() {return iterator(this, 0);}
+  iterator end() {return iterator(this, m_keys.size());}
+  const_iterator begin() const {return const_iterator(this, 0);}
+  const_iterator end() const {return const_iterator(this, m_keys.size());}
+
+private:
+  /// Never a valid packed key: size field would be 15
+  static const key_type s_empty = ~0ULL;
+
+  std::size_t slotOf(key_type key) const {
+    return VolumeIdentifierHash::mix(key) & (m_keys.size() - 1);
+  }
+
+  /// Slot holding @a key, or the empty slot where it would go
+  std::size_t locate(key_type key) const {
+    if (m_keys.empty()) return 0;
+    const std::size_t mask = m_keys.size() - 1;
+    std::size_t slot = slotOf(key);
+    while ((m_keys[slot] != key) && (m_keys[slot] != s_empty)) {
+      slot = (slot + 1) & mask;
+    }
+    return slot;
+  }
+
+  void rehash(std::size_t cap) {
+    std::vector<key_type> keys(cap, s_empty);
+    std::vector<T> values(cap);
+    keys.swap(m_keys);
+    values.swap(m_values);
+    for (std::size_t i = 0; i < keys.size(); i++) {
+      if (keys[i] == s_empty) continue;
+      std::size_t slot = locate(keys[i]);
+      m_keys[slot] = keys[i];
+      m_values[slot] = values[i];
+    }
+  }
+
+  std::vector<key_type> m_keys;
+  std::vector<T> m_values;
+  std::size_t m_size;
+};
+
+template <class T>
+const typename VolumeIdMap<T>::key_type VolumeIdMap<T>::s_empty;
+
+}
+#endif
@@ -0,0 +1,216 @@
+#ifndef idents_VolumeIdOrderedMap_h
+#define idents_VolumeIdOrderedMap_h
+
+#include "idents/VolumeIdentifier.h"
+#include "idents/BitOps.h"
+#include <vector>
+#include <utility>
+#include <stdexcept>
+#include <cstddef>
+
+namespace idents {
+
+/**
+ * @class VolumeIdOrderedMap
+ *
+ * @brief Read-only ordered map from VolumeIdentifier to T, built in one
+ * step from sorted input; a flat replacement for a std::map which is
+ * filled once and then only searched.
+ *
+ * Entries are kept in order of VolumeIdentifier::packedKey(), which is
+ * the order of operator<, so iteration, lower_bound() and subtree()
+ * behave as for std::map.  Searches go through a copy of the keys in
+ * Eytzinger (breadth-first) order: the root, then its two children,
+ * then the four grandchildren and so on.  The search path reads one
+ * key per level with no unpredictable branch, and the keys four
+ * levels further down lie in one or two cache lines, which are
+ * prefetched.  The Eytzinger node index found is mapped back to a
+ * position in sorted order through a parallel rank array.
+ *
+ * Values may be modified in place; the set of keys is fixed until the
+ * next build().
+ */
+template <class T>
+class VolumeIdOrderedMap {
+public:
+  typedef VolumeIdentifier::uint64 key_type;
+  typedef T mapped_type;
+
+  VolumeIdOrderedMap() {clear();}
+
+  /**
+   * Replace the contents with @a n entries (@a ids[i], @a values[i]).
+   * @a ids must be sorted and free of duplicates; throws
+   * std::invalid_argument otherwise.
+   */
+  void build(const VolumeIdentifier* ids, const T* values, std::size_t n) {
+    std::vector<key_type> keys(n);
+    for (std::size_t i = 0; i < n; i++) keys[i] = ids[i].packedKey();
+    assign(keys, std::vector<T>(values, values + n));
+  }
+
+  /// Replace the contents with the (VolumeIdentifier, T) pairs of
+  /// [first, last), for instance those of a std::map; must be sorted
+  /// and free of duplicates, as for build()
+  template <class It>
+  void build(It first, It last) {
+    std::vector<key_type> keys;
+    std::vector<T> values;
+    for (; first != last; ++first) {
+      keys.push_back(first->first.packedKey());
+      values.push_back(first->second);
+    }
+    assign(keys, values);
+  }
+
+  void clear() {
+    m_keys.clear();
+    m_values.clear();
+    m_tree.assign(1, 0);
+    m_rank.assign(1, 0);
+  }
+
+  std::size_t size() const {return m_keys.size();}
+  bool empty() const {return m_keys.empty();}
+
+  /// Random-access position in key order, giving key() and value()
+  template <class Map, class V>
+  class Iterator {
+  public:
+    Iterator(Map* map, std::size_t pos) : m_map(map), m_pos(pos) {}
+    VolumeIdentifier key() const {
+      return VolumeIdentifier::fromPackedKey(m_map->m_keys[m_pos]);
+    }
+    V& value() const {return m_map->m_values[m_pos];}
+    /// Position in key order
+    std::size_t index() const {return m_pos;}
+    Iterator& operator++() {++m_pos; return *this;}
+    Iterator& operator--() {--m_pos; return *this;}
+    bool operator==(const Iterator& o) const {return m_pos == o.m_pos;}
+    bool operator!=(const Iterator& o) const {return m_pos != o.m_pos;}
+  private:
+    Map* m_map;
+    std::size_t m_pos;
+  };
+  typedef Iterator<VolumeIdOrderedMap, T> iterator;
+  typedef Iterator<const VolumeIdOrderedMap, const T> const_iterator;
+
+  iterator begin() {return iterator(this, 0);}
+  iterator end() {return iterator(this, size());}
+  const_iterator begin() const {return const_iterator(this, 0);}
+  const_iterator end() const {return const_iterator(this, size());}
+
+  /// First entry not less than @a id
+  iterator lower_bound(const VolumeIdentifier& id) {
+    return iterator(this, lowerRank(id.packedKey()));
+  }
+  const_iterator lower_bound(const VolumeIdentifier& id) const {
+    return const_iterator(this, lowerRank(id.packedKey()));
+  }
+
+  /// First entry greater than @a id
+  iterator upper_bound(const VolumeIdentifier& id) {
+    return iterator(this, lowerRank(id.packedKey() + 1));
+  }
+  const_iterator upper_bound(const VolumeIdentifier& id) const {
+    return const_iterator(this, lowerRank(id.packedKey() + 1));
+  }
+
+  /// Value for @a id, or null if not present
+  T* find(const VolumeIdentifier& id) {
+    std::size_t pos = findRank(id.packedKey());
+    return (pos < size()) ? &m_values[pos] : 0;
+  }
+  const T* find(const VolumeIdentifier& id) const {
+    std::size_t pos = findRank(id.packedKey());
+    return (pos < size()) ? &m_values[pos] : 0;
+  }
+
+  bool contains(const VolumeIdentifier& id) const {return find(id) != 0;}
+
+  /// The entries which are @a prefix or lie beneath it, in order, as
+  /// [first, second)
+  std::pair<const_iterator, const_iterator>
+  subtree(const VolumeIdentifier& prefix) const {
+    return std::make_pair(const_iterator(this, lowerRank(prefix.packedKey())),
+                          const_iterator(this, lowerRank(subtreeEnd(prefix))));
+  }
+  std::pair<iterator, iterator> subtree(const VolumeIdentifier& prefix) {
+    return std::make_pair(iterator(this, lowerRank(prefix.packedKey())),
+                          iterator(this, lowerRank(subtreeEnd(prefix))));
+  }
+
+private:
+  void assign(std::vector<key_type>& keys, const std::vector<T>& values) {
+    for (std::size_t i = 1; i < keys.size(); i++) {
+      if (!(keys[i - 1] < keys[i])) {
+        throw std::invalid_argument
+          ("VolumeIdOrderedMap: identifiers not sorted or not unique");
+      }
+    }
+    const std::size_t n = keys.size();
+    // Node 0 is unused; an unsuccessful search ends there, at rank n
+    m_tree.assign(n + 1, 0);
+    m_rank.assign(n + 1, n);
+    if (n > 0) place(keys, 0, 1);
+    m_keys.swap(keys);
+    m_values = values;
+  }
+
+  /// Fill the subtree at node @a k in order, from sorted position
+  /// @a pos; returns the next position
+  std::size_t place(const std::vector<key_type>& keys, std::size_t pos,
+                    std::size_t k) {
+    if (k >= m_tree.size()) return pos;
+    pos = place(keys, pos, 2 * k);
+    m_tree[k] = keys[pos];
+    m_rank[k] = pos++;
+    return place(keys, pos, 2 * k + 1);
+  }
+
+  /// Sorted position of the first key >= @a key
+  std::size_t lowerRank(key_type key) const {
+    const key_type* tree = &m_tree[0];
+    const std::size_t n = m_tree.size() - 1;
+    std::size_t k = 1;
+    while (k <= n) {
+#ifdef __GNUC__
+      // the 16 descendants 4 levels down are contiguous; near the
+      // leaves they are past the end, and not even the address of
+      // them may be formed
+      if (16 * k <= n) __builtin_prefetch(tree + 16 * k);
+#endif
+      k = 2 * k + (tree[k] < key);
+    }
+    // Undo the right turns taken after the last left turn; that node
+    // is the answer (0, giving rank n, if there was no left turn)
+    k >>= bitops::ctz64(~(bitops::uint64) k) + 1;
+    return m_rank[k];
+  }
+
+  /// Sorted position of @a key, or size() if not present
+  std::size_t findRank(key_type key) const {
+    std::size_t pos = lowerRank(key);
+    return ((pos < size()) && (m_keys[pos] == key)) ? pos : size();
+  }
+
+  /// Smallest key beyond every descendant of @a prefix
+  static key_type subtreeEnd(const VolumeIdentifier& prefix) {
+    const VolumeIdentifier::int64 rest =
+      VolumeIdentifier::prefixMask(VolumeIdentifier::maxSize()) &
+      ~VolumeIdentifier::prefixMask(prefix.size());
+    return (((key_type) (prefix.getValue() | rest)) << 4) +
+      VolumeIdentifier::maxSize() + 1;
+  }
+
+  /// Keys in sorted order, with values parallel
+  std::vector<key_type> m_keys;
+  std::vector<T> m_values;
+  /// Keys in Eytzinger order from index 1
+  std::vector<key_type> m_tree;
+  /// Sorted position of each node of m_tree
+  std::vector<std::size_t> m_rank;
+};
+
+}
+#endif
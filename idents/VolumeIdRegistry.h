@@ -0,0 +1,228 @@
+#ifndef idents_VolumeIdRegistry_h
+#define idents_VolumeIdRegistry_h
+
+#include "idents/VolumeIdentifier.h"
+#include "idents/VolumeIdMap.h"
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace idents {
+
+/**
+ * @brief Atomic operations on the words of VolumeIdRegistry, through
+ * compiler intrinsics so as not to need C++11.
+ */
+namespace atomicops {
+
+  typedef VolumeIdentifier::uint64 uint64;
+
+  inline uint64 loadAcquire(const volatile uint64* p) {
+#ifdef _MSC_VER
+    uint64 v = *p;            // x86 and x64 loads are acquire
+    _ReadWriteBarrier();
+    return v;
+#else
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#endif
+  }
+
+  inline void storeRelease(volatile uint64* p, uint64 v) {
+#ifdef _MSC_VER
+    _ReadWriteBarrier();
+    *p = v;                   // x86 and x64 stores are release
+#else
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+#endif
+  }
+
+  /// Set *@a p to @a desired if it is @a expected; returns the value
+  /// found
+  inline uint64 compareExchange(volatile uint64* p, uint64 expected,
+                                uint64 desired) {
+#ifdef _MSC_VER
+    return (uint64) _InterlockedCompareExchange64
+      ((volatile __int64*) p, (__int64) desired, (__int64) expected);
+#else
+    __atomic_compare_exchange_n(p, &expected, desired, false,
+                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    return expected;
+#endif
+  }
+
+  inline uint64 fetchAdd(volatile uint64* p, uint64 v) {
+#ifdef _MSC_VER
+    return (uint64) _InterlockedExchangeAdd64((volatile __int64*) p,
+                                              (__int64) v);
+#else
+    return __atomic_fetch_add(p, v, __ATOMIC_RELAXED);
+#endif
+  }
+}
+
+/**
+ * @class VolumeIdRegistry
+ *
+ * @brief Fixed-capacity hash map from VolumeIdentifier to T which any
+ * number of threads may search and insert into at once, without locks.
+ *
+ * Meant for lookups filled in while worker threads start up (volume to
+ * sensitive detector, say) and then only searched.  Keys are
+ * VolumeIdentifier::packedKey() in an open-addressed table with linear
+ * probing, like VolumeIdMap.  An insert claims an empty slot with one
+ * compare-and-swap on the key, counts the entry, writes the value,
+ * then publishes it by setting the slot's ready flag with release
+ * ordering.  A search reads keys and the flag with acquire ordering;
+ * searches and inserts each finish in a bounded number of steps
+ * whatever other threads do.  An entry whose value is not yet
+ * published is reported absent by find(), and as pending by insert().
+ *
+ * Entries are never moved or removed, so pointers to values stay valid
+ * for the life of the registry.  Values are not synchronized after
+ * publication: modifying one while other threads read it is the
+ * caller's affair.  Once filling is done, freeze() copies the entries
+ * into a VolumeIdMap for single-threaded use.
+ */
+template <class T>
+class VolumeIdRegistry {
+public:
+  typedef VolumeIdentifier::uint64 key_type;
+  typedef T mapped_type;
+
+  /// Outcome of insert()
+  struct InsertResult {
+    /// The value stored for the identifier; null if the registry is
+    /// full, or if another thread is inserting the identifier and has
+    /// not yet published its value
+    const T* value;
+    /// true if this call inserted the entry
+    bool inserted;
+    /// true if another thread is inserting the identifier; find()
+    /// gives its value once published
+    bool pending;
+  };
+
+  /**
+   * Room for @a capacity entries.  The table has at least twice as
+   * many slots; threads inserting different identifiers at the moment
+   * the registry fills may each add one entry beyond @a capacity.
+   */
+  explicit VolumeIdRegistry(std::size_t capacity) : m_size(0) {
+    std::size_t slots = 16;
+    while (slots < 2 * capacity) slots *= 2;
+    m_capacity = capacity;
+    m_keys.assign(slots, s_empty);
+    m_ready.assign(slots, 0);
+    m_values.resize(slots);
+  }
+
+  std::size_t capacity() const {return m_capacity;}
+
+  /// Number of entries, published or not
+  std::size_t size() const {
+    return (std::size_t)
+      atomicops::loadAcquire(const_cast<volatile key_type*>(&m_size));
+  }
+
+  /// Value for @a id, or null if not present or not yet published
+  const T* find(const VolumeIdentifier& id) const {
+    const key_type key = id.packedKey();
+    const std::size_t mask = m_keys.size() - 1;
+    std::size_t slot = VolumeIdentifierHash::mix(key) & mask;
+    for (std::size_t probe = 0; probe <= mask; probe++) {
+      const key_type found = atomicops::loadAcquire(&m_keys[slot]);
+      if (found == key) {
+        return atomicops::loadAcquire(&m_ready[slot]) ? &m_values[slot] : 0;
+      }
+      if (found == s_empty) return 0;
+      slot = (slot + 1) & mask;
+    }
+    return 0;
+  }
+
+  bool contains(const VolumeIdentifier& id) const {return find(id) != 0;}
+
+  /**
+   * Insert (@a id, @a value) unless @a id is present.  Never waits
+   * for other threads: if one of them is inserting @a id and has not
+   * yet published its value, the result is pending and @a value is
+   * not stored.  Full only if capacity() entries are already present.
+   */
+  InsertResult insert(const VolumeIdentifier& id, const T& value) {
+    const key_type key = id.packedKey();
+    const std::size_t mask = m_keys.size() - 1;
+    std::size_t slot = VolumeIdentifierHash::mix(key) & mask;
+    InsertResult result;
+    result.value = 0;
+    result.inserted = false;
+    result.pending = false;
+    for (std::size_t probe = 0; probe <= mask; probe++) {
+      key_type found = atomicops::loadAcquire(&m_keys[slot]);
+      if (found == s_empty) {
+        // Only entries which won their slot are counted, so a full
+        // registry really holds capacity() identifiers
+        if (size() >= m_capacity) return result;
+        found = atomicops::compareExchange(&m_keys[slot], s_empty, key);
+        if (found == s_empty) {
+          atomicops::fetchAdd(&m_size, 1);
+          m_values[slot] = value;
+          atomicops::storeRelease(&m_ready[slot], 1);
+          result.value = &m_values[slot];
+          result.inserted = true;
+          return result;
+        }
+        // Lost the slot to another thread; look at what it wrote
+      }
+      if (found == key) {
+        if (atomicops::loadAcquire(&m_ready[slot])) {
+          result.value = &m_values[slot];
+        } else {
+          result.pending = true;
+        }
+        return result;
+      }
+      slot = (slot + 1) & mask;
+    }
+    // Every slot taken, by threads inserting past capacity() at once
+    return result;
+  }
+
+  /**
+   * Copy the published entries into @a map, replacing its contents.
+   * For use once inserting has finished.
+   */
+  void freeze(VolumeIdMap<T>& map) const {
+    map.clear();
+    map.reserve(size());
+    for (std::size_t slot = 0; slot < m_keys.size(); slot++) {
+      if (!atomicops::loadAcquire(&m_ready[slot])) continue;
+      map.insert(VolumeIdentifier::fromPackedKey(m_keys[slot]),
+                 m_values[slot]);
+    }
+  }
+
+private:
+  /// Never a valid packed key: size field would be 15
+  static const key_type s_empty = ~0ULL;
+
+  // Not copyable: other threads may hold pointers into the table
+  VolumeIdRegistry(const VolumeIdRegistry&);
+  VolumeIdRegistry& operator=(const VolumeIdRegistry&);
+
+  std::vector<key_type> m_keys;
+  /// 1 once the value of the slot is written
+  std::vector<key_type> m_ready;
+  std::vector<T> m_values;
+  std::size_t m_capacity;
+  key_type m_size;
+};
+
+template <class T>
+const typename VolumeIdRegistry<T>::key_type VolumeIdRegistry<T>::s_empty;
+
+}
+#endif
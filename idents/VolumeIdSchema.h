@@ -0,0 +1,214 @@
+#ifndef idents_VolumeIdSchema_h
+#define idents_VolumeIdSchema_h
+
+#include "idents/VolumeIdentifier.h"
+#include <string>
+#include <iosfwd>
+
+namespace idents {
+
+/**
+ * @class VolumeIdSchema
+ *
+ * @brief Positions of the VolumeIdentifier fields understood by the id
+ * classes, and the values which select subsystems and volume types.
+ *
+ * TkrId, CalXtalId, AcdId and CompactVolumeId used to assume a fixed
+ * layout, correct for the xmlGeoDbs geometries of 2004.  They now read
+ * it from the installed schema, so a change in the way the geometry
+ * assembles identifiers can be described in a text file instead of in
+ * code.  By default the built-in description, which is that fixed
+ * layout, is installed.  The VolumeIdentifier::is.. routines and
+ * classify() keep the fixed layout as compile-time constants; they are
+ * given the masks of a schema explicitly, as vid.isTkr(schema.
+ * subsystemSelect()) or, for the installed one, vid.isTkr(select()).
+ *
+ * A description file has one entry per line; '#' starts a comment.
+ * @verbatim
+   field <name> <index>     e.g.   field TkrWafer 8
+   value <name> <value>     e.g.   value AcdTile 40
+   widths <subsystem> <bits for field 0> <bits for field 1> ...
+                            e.g.   widths Cal 1 2 2 1 3 1 4 3 4
+   @endverbatim
+ * Names are those of the Field and Value enums without the leading
+ * 'f' or 'e'; subsystems are Tkr, Cal and Acd.  Entries not mentioned
+ * keep their built-in setting.  The widths give the number of bits 
+ * each field of a subsystem's identifiers takes in a CompactVolumeId.
+ *
+ * A schema is compiled, when built or read, into a flat table of field
+ * shifts and subsystem masks; install() copies that table to where the
+ * static accessors read it with a single load.  install() is not
+ * thread-safe: call it at startup, before starting any thread which
+ * decodes identifiers, so that the threads see the whole table.
+ */
+class VolumeIdSchema {
+public:
+  /// Logical fields of an identifier.  The first four are shared by
+  /// tracker and calorimeter volumes; fLATObjects also by the ACD.
+  enum Field {
+    fLATObjects = 0,
+    fTowerY,
+    fTowerX,
+    fTowerObjects,
+    fTkrTray,
+    fTkrMeasure,
+    fTkrBotTop,
+    fTkrLadder,
+    fTkrWafer,
+    fCalLayer,
+    fCalMeasure,
+    fCalLog,
+    fCalCellCmp,
+    fAcdFace,
+    fAcdType,
+    fAcdRow,
+    fAcdColumn,
+    fAcdBent,
+    fAcdRibbonOrient,
+    fAcdRibbonNum,
+    eNumFields
+  };
+
+  /// Field values with special meaning
+  enum Value {
+    eLATTowers = 0,   ///< fLATObjects of tower volumes
+    eLATACD,          ///< fLATObjects of ACD volumes
+    eTowerCAL,        ///< fTowerObjects of calorimeter volumes
+    eTowerTKR,        ///< fTowerObjects of tracker volumes
+    eAcdTile,         ///< fAcdType of tiles
+    eAcdRibbon,       ///< fAcdType of ribbons
+    eNumValues
+  };
+
+  /// The built-in description
+  VolumeIdSchema();
+
+  /// Description read from file @a fileName, which may contain
+  /// environment variables as $(NAME).  Throws std::invalid_argument
+  /// if the file cannot be read or is malformed.
+  explicit VolumeIdSchema(const std::string& fileName);
+
+  /// Apply the entries read from @a in on top of the current
+  /// description.  @a source names the input in error messages.
+  void read(std::istream& in, const std::string& source = "schema");
+
+  /// Position of field @a f in identifiers described by this schema
+  unsigned fieldIndex(Field f) const {return m_tables.index[f];}
+
+  /// Value @a v in identifiers described by this schema
+  unsigned fieldValue(Value v) const {return m_tables.value[v];}
+
+  /// Number of fields of subsystem @a s identifiers which a
+  /// CompactVolumeId can hold
+  unsigned compactLevels(VolumeIdentifier::Subsystem s) const {
+    return m_tables.compact[s].levels;
+  }
+
+  /// Bits taken by field @a level of subsystem @a s in a CompactVolumeId
+  unsigned compactWidth(VolumeIdentifier::Subsystem s, unsigned level) const {
+    return m_tables.compact[s].width[level];
+  }
+
+  /// Masks telling subsystems apart in identifiers described by this
+  /// schema, for VolumeIdentifier::classify() and the is.. routines
+  const VolumeIdentifier::SubsystemSelect& subsystemSelect() const {
+    return m_tables.select;
+  }
+
+  /// Make this the schema used to decode and build identifiers
+  void install() const;
+
+  /// Name of field @a f or value @a v as used in description files
+  static const char* name(Field f);
+  static const char* name(Value v);
+
+  // Decoding with the installed schema
+
+  /// Position of field @a f
+  static unsigned index(Field f) {return s_active->index[f];}
+
+  /// Value @a v
+  static unsigned value(Value v) {return s_active->value[v];}
+
+  /// Masks telling subsystems apart
+  static const VolumeIdentifier::SubsystemSelect& select() {
+    return s_active->select;
+  }
+
+  /// true if @a vid is long enough to have field @a f
+  static bool has(const VolumeIdentifier& vid, Field f) {
+    return vid.size() > (int) s_active->index[f];
+  }
+
+  /// Field @a f of @a vid
+  static unsigned get(const VolumeIdentifier& vid, Field f) {
+    return (vid.getValue() >> s_active->shift[f]) &
+      VolumeIdentifier::maxFieldValue();
+  }
+
+  /// Set field @a f of @a vid to @a v, lengthening @a vid if needed
+  /// so that it has the field; fields skipped over are zero.  Throws
+  /// std::range_error if @a v does not fit in a field.
+  static void set(VolumeIdentifier& vid, Field f, unsigned v);
+
+  /// Placement of the fields of one subsystem in a CompactVolumeId:
+  /// field i takes the width[i] bits from bit shift[i] up, fields 
+  /// running from the most significant end.  Unused levels have 
+  /// width 0.
+  struct CompactLayout {
+    unsigned levels;
+    unsigned char width[VolumeIdentifier::s_maxSize];
+    unsigned char shift[VolumeIdentifier::s_maxSize];
+  };
+
+  /// Compact layout of subsystem @a s; that of eOther has no levels
+  static const CompactLayout& compactLayout(VolumeIdentifier::Subsystem s) {
+    return s_active->compact[s];
+  }
+
+  /// Bits of a CompactVolumeId below the fields, holding the size
+  static const unsigned s_compactSizeBits = 4;
+
+private:
+  /// Compiled form: per field its index and shift, per value its 
+  /// value, per subsystem its compact layout, and the subsystem masks
+  struct Tables {
+    unsigned index[eNumFields];
+    unsigned shift[eNumFields];
+    unsigned value[eNumValues];
+    CompactLayout compact[VolumeIdentifier::eNumSubsystems];
+    VolumeIdentifier::SubsystemSelect select;
+  };
+
+  /// Set shifts and subsystem masks from indices and values, and
+  /// check the description is usable
+  void compile(const std::string& source);
+
+  /// Set compact shifts from widths and check the layouts
+  void compileCompact(const std::string& source);
+
+  Tables m_tables;
+
+  static const Tables s_builtin;
+  static Tables s_installed;
+  /// Points to s_builtin until install() is first called.  Both are
+  /// initialized statically, so decoding is correct even during
+  /// static initialization of other modules.
+  static const Tables* s_active;
+};
+
+inline void VolumeIdSchema::set(VolumeIdentifier& vid, Field f, unsigned v)
+{
+  if (v > VolumeIdentifier::maxFieldValue()) {
+    throw std::range_error("VolumeIdSchema::set: field value is too large");
+  }
+  const unsigned shift = s_active->shift[f];
+  const int size = s_active->index[f] + 1;
+  vid.init((vid.getValue() & ~((VolumeIdentifier::int64)
+                                VolumeIdentifier::maxFieldValue() << shift)) |
+           ((VolumeIdentifier::int64) v << shift),
+           (vid.size() > size) ? vid.size() : size);
+}
+
+}
+#endif
@@ -0,0 +1,67 @@
+#ifndef idents_VolumeIdSort_h
+#define idents_VolumeIdSort_h
+
+#include "idents/VolumeIdentifier.h"
+#include "idents/PackedVolumeId.h"
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstddef>
+
+/**
+ * @file VolumeIdSort.h
+ *
+ * @brief LSD radix sort for large collections of VolumeIdentifiers.
+ *
+ * Sorts on VolumeIdentifier::packedKey(), which orders exactly as 
+ * operator<, one byte per pass; passes in which every key has the
+ * same byte are skipped.  Where the compiler has OpenMP the sort is
+ * compiled with it, and the histogram and scatter phases of each pass
+ * are split across threads for large inputs; programs using it then
+ * link with OpenMP, which env.Tool('identsLib', openmp = 1) arranges.
+ * Collections must hold fewer than 2^32 elements.
+ */
+
+namespace idents {
+
+  namespace detail {
+    /// Stable sort of @a keys; if @a index is non-null, the same
+    /// permutation is applied to it
+    void radixSortKeys(VolumeIdentifier::uint64* keys, unsigned* index,
+                       std::size_t n);
+
+    template <class T>
+    bool lessFirst(const std::pair<VolumeIdentifier, T>& a,
+                   const std::pair<VolumeIdentifier, T>& b) {
+      return a.first < b.first;
+    }
+  }
+
+  /// Sort @a ids into the same order std::sort would give
+  void radixSort(std::vector<VolumeIdentifier>& ids);
+  void radixSort(std::vector<PackedVolumeId>& ids);
+
+  /// Stable sort of (identifier, payload) pairs by identifier
+  template <class T>
+  void radixSort(std::vector<std::pair<VolumeIdentifier, T> >& items) {
+    const std::size_t n = items.size();
+    if (n < 256) {
+      std::stable_sort(items.begin(), items.end(), detail::lessFirst<T>);
+      return;
+    }
+    std::vector<VolumeIdentifier::uint64> keys(n);
+    std::vector<unsigned> index(n);
+    for (std::size_t i = 0; i < n; i++) {
+      keys[i] = items[i].first.packedKey();
+      index[i] = i;
+    }
+    detail::radixSortKeys(&keys[0], &index[0], n);
+
+    std::vector<std::pair<VolumeIdentifier, T> > sorted;
+    sorted.reserve(n);
+    for (std::size_t i = 0; i < n; i++) sorted.push_back(items[index[i]]);
+    items.swap(sorted);
+  }
+
+}
+#endif
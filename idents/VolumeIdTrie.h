@@ -0,0 +1,86 @@
+#ifndef idents_VolumeIdTrie_h
+#define idents_VolumeIdTrie_h
+
+#include "idents/VolumeIdentifier.h"
+#include <vector>
+#include <cstddef>
+
+namespace idents {
+
+/**
+ * @class VolumeIdTrie
+ *
+ * @brief Prefix tree over a set of VolumeIdentifiers, for subtree
+ * queries such as "all volumes in the tracker of tower (2,3)".
+ *
+ * Each level of the tree corresponds to one 6-bit field; a node keeps
+ * a 64-bit mask of the field values of its children, which are stored
+ * next to each other in field order in one array of nodes, so finding
+ * a child is a popcount added to the index of the first.  Fields are read
+ * most significant first straight from VolumeIdentifier::getValue().
+ * Lookup and subtree location cost O(size of prefix); subtree counts
+ * are kept in the nodes.  Enumeration returns identifiers in sorted
+ * order.
+ *
+ * A stored identifier is "under" a prefix if it equals the prefix or
+ * the prefix is an initial sequence of its fields.
+ */
+class VolumeIdTrie {
+public:
+  VolumeIdTrie() { clear(); }
+
+  /// Insert @a id; returns false if it was already present.  A node
+  /// gaining a child has its children moved to the end of the node
+  /// array, leaving their old places unused until the next build().
+  bool insert(const VolumeIdentifier& id);
+
+  /// Replace contents with the @a n identifiers in @a sorted, which 
+  /// must be in ascending order.  Duplicates are ignored.
+  void build(const VolumeIdentifier* sorted, std::size_t n);
+
+  void build(const std::vector<VolumeIdentifier>& sorted) {
+    build(sorted.empty() ? 0 : &sorted[0], sorted.size());
+  }
+
+  void clear();
+
+  /// Number of identifiers stored
+  std::size_t size() const {return m_nodes[0].count;}
+
+  bool contains(const VolumeIdentifier& id) const;
+
+  /// Number of stored identifiers under @a prefix
+  std::size_t count(const VolumeIdentifier& prefix) const;
+
+  /// Append stored identifiers under @a prefix to @a out, in order
+  void subtree(const VolumeIdentifier& prefix,
+               std::vector<VolumeIdentifier>& out) const;
+
+private:
+  typedef VolumeIdentifier::uint64 uint64;
+  typedef VolumeIdentifier::int64 int64;
+
+  struct Node {
+    Node() : childMask(0), firstChild(0), count(0), terminal(false) {}
+    uint64 childMask;               ///< bit f set if child for field f
+    unsigned firstChild;            ///< index of child for lowest field
+    unsigned count;                 ///< stored identifiers in subtree
+    bool terminal;                  ///< node itself is a stored identifier
+  };
+
+  /// Insert @a id, known not to be present
+  void insertNew(const VolumeIdentifier& id);
+
+  /// Index of node for @a prefix, or -1 if none
+  int findNode(const VolumeIdentifier& prefix) const;
+
+  void collect(unsigned node, int64 value, unsigned depth,
+               std::vector<VolumeIdentifier>& out) const;
+
+  /// node 0 is the root, the empty prefix; the children of a node
+  /// follow one another, in ascending field
+  std::vector<Node> m_nodes;
+};
+
+}
+#endif
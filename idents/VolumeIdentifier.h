@@ -3,6 +3,9 @@
 #define VolumeIdentifier_h
 
 #include <string>
+#include <vector>
+#include <cstddef>
+#include <stdexcept>
 
 /** 
  * @class VolumeIdentifier
@@ -27,41 +30,229 @@ public:
 
 #ifdef WIN32
     typedef __int64 int64;
+    typedef unsigned __int64 uint64;
 #else
     typedef  long long int64;
+    typedef  unsigned long long uint64;
 #endif
 
-    VolumeIdentifier();
+    /// Subsystems told apart by classify()
+    enum Subsystem {
+      eOther = 0,
+      eTkr,
+      eCal,
+      eAcd,
+      eNumSubsystems
+    };
+
+    /// Status values returned by methods which report errors 
+    /// without throwing
+    enum Status {
+      eOk = 0,
+      eTooManyFields,   ///< more than the maximum number of fields
+      eFieldTooLarge,   ///< a field exceeds maxFieldValue()
+      eEmptyField,      ///< a field with no digits
+      eBadCharacter     ///< character other than a digit or delimiter
+    };
+
+    inline VolumeIdentifier();
 
     /** 
      * This method initialize the VolumeIdentifier with a 64 bit integer 
      * and a size and is used by the overloaded operator<< to build an 
      * identifier reading from a persistent data store
      */
-    void init(int64 , unsigned int); 
+    inline void init(int64 , unsigned int); 
 
     int64 getValue() const{ return m_value;}
 
     /// prepend, in front, another id
-    void prepend( const VolumeIdentifier& id);
+    inline void prepend( const VolumeIdentifier& id);
 
     /// append another id
-    void append( const VolumeIdentifier& id);
+    inline void append( const VolumeIdentifier& id);
 
     /// append an int
-    void append(unsigned int id);
+    inline void append(unsigned int id);
+
+    /** 
+     * Identifier with fields given as template arguments, e.g.
+     * VolumeIdentifier::make<1, 0, 40>() for the ACD tile prefix.
+     * The packed value is a compile-time constant, so constant prefixes
+     * cost nothing in loops; a field larger than maxFieldValue() is a
+     * compile error.
+     */
+    template <unsigned f0>
+    static VolumeIdentifier make() {
+      return VolumeIdentifier(PackedField<f0, 0>::value, 1);
+    }
+    template <unsigned f0, unsigned f1>
+    static VolumeIdentifier make() {
+      return VolumeIdentifier(PackedField<f0, 0>::value |
+                              PackedField<f1, 1>::value, 2);
+    }
+    template <unsigned f0, unsigned f1, unsigned f2>
+    static VolumeIdentifier make() {
+      return VolumeIdentifier(PackedField<f0, 0>::value |
+                              PackedField<f1, 1>::value |
+                              PackedField<f2, 2>::value, 3);
+    }
+    template <unsigned f0, unsigned f1, unsigned f2, unsigned f3>
+    static VolumeIdentifier make() {
+      return VolumeIdentifier(PackedField<f0, 0>::value |
+                              PackedField<f1, 1>::value |
+                              PackedField<f2, 2>::value |
+                              PackedField<f3, 3>::value, 4);
+    }
+    template <unsigned f0, unsigned f1, unsigned f2, unsigned f3,
+              unsigned f4>
+    static VolumeIdentifier make() {
+      return VolumeIdentifier(make<f0, f1, f2, f3>().m_value |
+                              PackedField<f4, 4>::value, 5);
+    }
+    template <unsigned f0, unsigned f1, unsigned f2, unsigned f3,
+              unsigned f4, unsigned f5>
+    static VolumeIdentifier make() {
+      return VolumeIdentifier(make<f0, f1, f2, f3>().m_value |
+                              PackedField<f4, 4>::value |
+                              PackedField<f5, 5>::value, 6);
+    }
+    template <unsigned f0, unsigned f1, unsigned f2, unsigned f3,
+              unsigned f4, unsigned f5, unsigned f6>
+    static VolumeIdentifier make() {
+      return VolumeIdentifier(make<f0, f1, f2, f3>().m_value |
+                              PackedField<f4, 4>::value |
+                              PackedField<f5, 5>::value |
+                              PackedField<f6, 6>::value, 7);
+    }
+    template <unsigned f0, unsigned f1, unsigned f2, unsigned f3,
+              unsigned f4, unsigned f5, unsigned f6, unsigned f7>
+    static VolumeIdentifier make() {
+      return VolumeIdentifier(make<f0, f1, f2, f3>().m_value |
+                              PackedField<f4, 4>::value |
+                              PackedField<f5, 5>::value |
+                              PackedField<f6, 6>::value |
+                              PackedField<f7, 7>::value, 8);
+    }
+    template <unsigned f0, unsigned f1, unsigned f2, unsigned f3,
+              unsigned f4, unsigned f5, unsigned f6, unsigned f7,
+              unsigned f8>
+    static VolumeIdentifier make() {
+      return VolumeIdentifier(make<f0, f1, f2, f3, f4, f5, f6, f7>().m_value |
+                              PackedField<f8, 8>::value, 9);
+    }
+    template <unsigned f0, unsigned f1, unsigned f2, unsigned f3,
+              unsigned f4, unsigned f5, unsigned f6, unsigned f7,
+              unsigned f8, unsigned f9>
+    static VolumeIdentifier make() {
+      return VolumeIdentifier(make<f0, f1, f2, f3, f4, f5, f6, f7>().m_value |
+                              PackedField<f8, 8>::value |
+                              PackedField<f9, 9>::value, 10);
+    }
 
     /// number of single ids which constitute the volume identifier
     int size() const { return m_size;}
 
+    /** 
+     * Value and size in a single word: the value is shifted up over the
+     * 4 unused bits and the size occupies the low 4 bits.  Distinct
+     * identifiers have distinct keys, and unsigned comparison of keys
+     * orders identifiers exactly as operator< does.
+     */
+    uint64 packedKey() const { return ((uint64) m_value << 4) | m_size; }
+
+    /// Inverse of packedKey()
+    static VolumeIdentifier fromPackedKey(uint64 key) {
+      return VolumeIdentifier((int64) (key >> 4), (unsigned) (key & 0xf));
+    }
+
     /// return a name made up with slash delimiters
     std::string name(const char * delimiter="/")const ;
+
+    /** 
+     * Write the name into a caller-supplied buffer without allocating.
+     * Output is identical to name(delimiter).  Returns the length of the
+     * name, not counting the terminating null; nothing is written
+     * unless @a bufSize is greater than that length.
+     */
+    unsigned name(char* buf, unsigned bufSize, 
+                  const char* delimiter="/") const;
+
+    /// Buffer size (including terminating null) sufficient for any name
+    static unsigned maxNameLength(const char* delimiter="/");
+
+    /** 
+     * Format the names of @a n identifiers into one contiguous @a arena.
+     * Name i is the null-terminated string starting at arena[offsets[i]];
+     * @a offsets gets n+1 entries, the last one being the arena size.
+     * Storage already held by @a arena and @a offsets is reused.
+     */
+    static void names(const VolumeIdentifier* ids, unsigned n,
+                      std::vector<char>& arena, 
+                      std::vector<unsigned>& offsets,
+                      const char* delimiter="/");
+
+    /** 
+     * Inverse of name(): parse @a len characters of @a text into @a id.
+     * The leading delimiter may be omitted and a trailing one is
+     * tolerated; empty text gives an empty identifier.  @a delimiter
+     * must not be empty.  Never throws; @a id is modified only if the
+     * returned status is eOk.
+     */
+    static Status parse(const char* text, std::size_t len, 
+                        VolumeIdentifier& id, const char* delimiter="/");
+
+    static Status parse(const std::string& text, VolumeIdentifier& id,
+                        const char* delimiter="/") {
+      return parse(text.data(), text.size(), id, delimiter);
+    }
+
+    /** 
+     * Parse a buffer (e.g. a memory-mapped file) holding one name per
+     * line, appending the identifiers to @a ids.  Blank lines are
+     * skipped and a carriage return before the newline is ignored.
+     * Stops at the first bad line, returning its status and, if 
+     * @a badLine is non-null, its 0-based line number; identifiers from 
+     * earlier lines have already been appended.
+     */
+    static Status parseLines(const char* buf, std::size_t len,
+                             std::vector<VolumeIdentifier>& ids,
+                             const char* delimiter="/", 
+                             std::size_t* badLine=0);
+
+    /**
+     * Build @a id from the @a n fields in @a fields, most significant
+     * first, as @a n calls to append() would.  All fields are range
+     * checked at once; never throws, and @a id is modified only if the
+     * returned status is eOk.
+     */
+    static Status build(const unsigned char* fields, unsigned n,
+                        VolumeIdentifier& id);
+
+    /**
+     * Build @a count identifiers from a matrix of fields, row i of 
+     * @a depth fields starting at fields[i*depth].  If @a sizes is 
+     * non-null row i has sizes[i] <= depth fields and the rest of the
+     * row is ignored.  On error returns the status of the first bad
+     * row and, if @a badRow is non-null, its index; earlier rows have
+     * been built.
+     */
+    static Status build(const unsigned char* fields, std::size_t count,
+                        unsigned depth, VolumeIdentifier* out,
+                        const unsigned char* sizes=0, 
+                        std::size_t* badRow=0);
+
+    /**
+     * All fields at once, the inverse of build(): field i to 
+     * @a fields[i] for i < maxSize(), those beyond size() being 0.
+     */
+    void unpack(unsigned char* fields) const;
  
     /// access single ids which constitute the volume identifier
-    unsigned int operator[](unsigned int);
+    inline unsigned int operator[](unsigned int);
     
     /// access single ids which constitute the volume identifier
-    unsigned int operator[](unsigned int) const;
+    inline unsigned int operator[](unsigned int) const;
     
     /// overload the < operator for correct sorting of volume identifiers
     bool operator<(const VolumeIdentifier& id)const
@@ -75,29 +266,126 @@ public:
         return ((m_value == id.getValue()) && (m_size==id.size()));
     }
 
-    /// return true iff VolumeIdentifier fields say "tracker"
-    bool isTkr() const {return ( (m_size > (int) fTowerObj) &&
-                           ( (*this)[fLATObj] == eLATTowers) &&
-                           ( (*this)[fTowerObj] == eTowerTKR)  ); }
+    bool operator!=(const VolumeIdentifier& id)const
+    {
+        return !(*this == id);
+    }
+
+    /// Masks and patterns telling the subsystems apart, for one
+    /// layout of the fields.  builtinSelect() gives those of the
+    /// xmlGeoDbs geometry; VolumeIdSchema::select() those of the
+    /// installed schema.
+    struct SubsystemSelect {
+      int64 towerSelect;  ///< bits of fields fLATObjects and fTowerObjects
+      int64 tkrPattern;   ///< their value in tracker volumes
+      int64 calPattern;   ///< their value in calorimeter volumes
+      int64 acdSelect;    ///< bits of field fLATObjects
+      int64 acdPattern;   ///< its value in ACD volumes
+      int towerMinSize;   ///< largest index of a field in towerSelect
+      int acdMinSize;     ///< index of the field in acdSelect
+    };
+
+    /// Masks of the built-in layout; compile-time constants once inlined
+    static SubsystemSelect builtinSelect() {
+      const SubsystemSelect sel = {
+        s_towerSelect, s_tkrPattern, s_calPattern, s_acdSelect, s_acdPattern,
+        fTowerObj, fLATObj
+      };
+      return sel;
+    }
 
+    /// return true iff VolumeIdentifier fields say "tracker".  Without
+    /// @a sel the built-in layout is assumed; pass 
+    /// VolumeIdSchema::select() to follow the installed schema.
+    bool isTkr(const SubsystemSelect& sel = builtinSelect()) const {
+      return ((m_size > sel.towerMinSize) &&
+              ((m_value & sel.towerSelect) == sel.tkrPattern));
+    }
 
     /// return true iff VolumeIdentifier fields say "calorimeter"
-    bool isCal() const {return ( (m_size > (int) fTowerObj) &&
-                           ( (*this)[fLATObj] == eLATTowers) &&
-                           ( (*this)[fTowerObj] == eTowerCAL)  ); }
+    bool isCal(const SubsystemSelect& sel = builtinSelect()) const {
+      return ((m_size > sel.towerMinSize) &&
+              ((m_value & sel.towerSelect) == sel.calPattern));
+    }
 
     /// return true iff VolumeIdentifier fields say "ACD"
-    bool isAcd() const {return ((m_size > (int) fLATObj) && 
-                          ((*this)[fLATObj] == eLATACD)); }
+    bool isAcd(const SubsystemSelect& sel = builtinSelect()) const {
+      return ((m_size > sel.acdMinSize) && 
+              ((m_value & sel.acdSelect) == sel.acdPattern));
+    }
+
+    /// Subsystem according to the fields, without branching.  
+    /// Equivalent to testing isTkr(), isCal() and isAcd() in turn.
+    Subsystem classify(const SubsystemSelect& sel = builtinSelect()) const {
+      const int64 towerFields = m_value & sel.towerSelect;
+      const bool tower = (m_size > sel.towerMinSize);
+      return Subsystem(((tower && (towerFields == sel.tkrPattern)) * eTkr) |
+                       ((tower && (towerFields == sel.calPattern)) * eCal) |
+                       (((m_size > sel.acdMinSize) && 
+                         ((m_value & sel.acdSelect) == sel.acdPattern)) * 
+                        eAcd));
+    }
+
+    /// Count the identifiers of each subsystem; @a counts[s] is set
+    /// to the number for which classify(sel) returns s
+    static void countSubsystems(const VolumeIdentifier* ids, std::size_t n,
+                                std::size_t counts[eNumSubsystems],
+                                const SubsystemSelect& sel = builtinSelect());
+
+    /**
+     * Copy each of @a ids to the bucket for its subsystem, keeping
+     * their order.  out[s] must have room for the number of
+     * identifiers of subsystem s, as found by countSubsystems(), and
+     * is advanced past the identifiers written.
+     */
+    static void partitionSubsystems(const VolumeIdentifier* ids, 
+                                    std::size_t n,
+                                    VolumeIdentifier* out[eNumSubsystems],
+                                    const SubsystemSelect& sel = 
+                                    builtinSelect());
 
     /// Max allowed value for a single field
     static unsigned maxFieldValue() { return s_maxFieldValue;}
+
+    /// Max number of fields in an identifier
+    static unsigned maxSize() { return s_maxSize;}
+
+    /// Bit position in getValue() of least significant bit of field @a i
+    static unsigned fieldShift(unsigned i) {return s_maxShift - s_bitsPer*i;}
+
+    /// Mask selecting the bits of getValue() which hold the first 
+    /// @a n fields
+    static int64 prefixMask(unsigned n) {
+      const int64 all = (1LL << (s_maxShift + s_bitsPer)) - 1;
+      return all & ~((1LL << (s_maxShift + s_bitsPer - s_bitsPer*n)) - 1);
+    }
+
+    /**
+     * true if this identifier is @a prefix or lies beneath it, that is
+     * its leading fields are those of @a prefix.  One masked compare.
+     */
+    bool isDescendantOf(const VolumeIdentifier& prefix) const {
+      return (m_size >= prefix.m_size) &&
+        (((m_value ^ prefix.m_value) & prefixMask(prefix.m_size)) == 0);
+    }
                                                        
 private:
 
-    /// The following values must correspond with those defined 
-    /// in the xml geometry files in use when the VolumeIdentifier 
-    /// was created, or the is.. routines above will lie.
+    VolumeIdentifier(int64 value, unsigned int size) 
+      : m_value(value), m_size(size) {}
+
+    /// Only the true case is defined, so instantiating the false
+    /// case stops compilation
+    template <bool> struct CompileTimeCheck;
+
+    /// Field value @a field placed at position @a pos, checked at
+    /// compile time
+    template <unsigned field, unsigned pos> struct PackedField;
+
+    /// The following values are the defaults for the layout defined
+    /// in the xml geometry files.  If the geometry in use assembles
+    /// identifiers differently, the is.. routines above must be given
+    /// the masks of a VolumeIdSchema describing it.
     static const unsigned fLATObj = 0;
     static const unsigned fTowerObj = 3;
     static const unsigned eLATTowers = 0;
@@ -114,11 +402,128 @@ private:
     static const unsigned s_maxShift = (s_maxSize - 1) * s_bitsPer;   /* 54 */
     static const unsigned s_maxFieldValue = (1 << s_bitsPer) - 1;
 
+    /// Bits of fields fLATObj and fTowerObj, and their values for
+    /// tracker and calorimeter volumes
+    static const int64 s_towerSelect = 
+      ((int64) s_maxFieldValue << (s_maxShift - s_bitsPer*fLATObj)) |
+      ((int64) s_maxFieldValue << (s_maxShift - s_bitsPer*fTowerObj));
+    static const int64 s_tkrPattern =
+      ((int64) eLATTowers << (s_maxShift - s_bitsPer*fLATObj)) |
+      ((int64) eTowerTKR << (s_maxShift - s_bitsPer*fTowerObj));
+    static const int64 s_calPattern =
+      ((int64) eLATTowers << (s_maxShift - s_bitsPer*fLATObj)) |
+      ((int64) eTowerCAL << (s_maxShift - s_bitsPer*fTowerObj));
+
+    /// Bits of field fLATObj, and its value for ACD volumes
+    static const int64 s_acdSelect = 
+      (int64) s_maxFieldValue << (s_maxShift - s_bitsPer*fLATObj);
+    static const int64 s_acdPattern =
+      (int64) eLATACD << (s_maxShift - s_bitsPer*fLATObj);
+
+    friend class VolumeIdSchema;
+
+    /// Length of name written by name(char*,...) given delimiter length
+    unsigned nameLength(unsigned delimLen) const;
+
+    /// Write name to @a buf, which must be at least nameLength()+1 long
+    void writeName(char* buf, const char* delimiter, unsigned delimLen) const;
+
     /// internal rappresentation of the volume identifier
     int64 m_value; // for sorting
     /// number of single ids which constitute the volume identifier
     int m_size;
 };
 
+// inline declarations
+
+/// Hash function object for VolumeIdentifier, for use with hashed
+/// containers.  Mixes all bits of the packed key.
+struct VolumeIdentifierHash {
+  std::size_t operator()(const VolumeIdentifier& id) const {
+    return mix(id.packedKey());
+  }
+
+  /// 64-bit finalizer from MurmurHash3
+  static VolumeIdentifier::uint64 mix(VolumeIdentifier::uint64 k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+  }
+};
+
+template <> struct VolumeIdentifier::CompileTimeCheck<true> {};
+
+template <unsigned field, unsigned pos> 
+struct VolumeIdentifier::PackedField {
+#if __cplusplus >= 201103L
+  static_assert(field <= s_maxFieldValue,
+                "VolumeIdentifier::make: field value is too large");
+#else
+  enum { fieldOk = sizeof(CompileTimeCheck<(field <= s_maxFieldValue)>) };
+#endif
+  static const int64 value = (int64) field << (s_maxShift - s_bitsPer*pos);
+};
+
+inline VolumeIdentifier::VolumeIdentifier():  m_value(0), m_size(0){}
+
+inline void VolumeIdentifier::init(int64 value, unsigned int size)
+{
+    m_value = value;
+    m_size = size;
+}
+
+inline unsigned int VolumeIdentifier::operator[](unsigned int index)
+{
+    return (m_value >> (s_maxShift - s_bitsPer*index)) & s_maxFieldValue;
 }
+
+inline unsigned int VolumeIdentifier::operator[](unsigned int index) const
+{
+    return (m_value >> (s_maxShift - s_bitsPer*index)) & s_maxFieldValue;
+}
+
+inline void VolumeIdentifier::prepend( const VolumeIdentifier& id)
+{
+    m_value = (m_value >> (s_bitsPer*id.size())) | id.getValue();
+    m_size += id.size();
+}
+
+inline void VolumeIdentifier::append( const VolumeIdentifier& id)
+{
+    m_value = m_value | (id.getValue() >> (s_bitsPer*m_size));
+    m_size += id.size();
+}
+
+inline void VolumeIdentifier::append( unsigned int id)
+{
+  // the first id appended becomes the most significant digit in the internal
+  // rappresentation. In this way I can obtain an equivalent of the lexicographic order
+  // between volume identifiers
+  if (m_size >= (int) s_maxSize) {
+    throw std::range_error
+      ("VolumeIdentifier::append: id is already of maximum size");
+  }
+  else if (id > s_maxFieldValue) {
+    throw std::range_error
+      ("VolumeIdentifier::append: new field value is too large");
+  }
+  int64 t = id;
+  t = t << s_maxShift;
+  m_value = m_value | (t >> s_bitsPer*m_size);
+  m_size++;
+}
+
+}
+
+#if __cplusplus >= 201103L
+#include <functional>
+namespace std {
+  template <> struct hash<idents::VolumeIdentifier> 
+    : public idents::VolumeIdentifierHash {};
+}
+#endif
+
 #endif
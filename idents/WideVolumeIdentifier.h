@@ -0,0 +1,188 @@
+#ifndef idents_WideVolumeIdentifier_h
+#define idents_WideVolumeIdentifier_h
+
+#include "idents/VolumeIdentifier.h"
+#include <string>
+#include <cstddef>
+#include <stdexcept>
+
+namespace idents {
+
+/**
+ * @class WideVolumeIdentifier
+ *
+ * @brief A VolumeIdentifier of up to 20 fields, for geometries nested
+ * more deeply than VolumeIdentifier's 10 fields allow.
+ *
+ * Two words are used, each laid out like VolumeIdentifier::packedKey():
+ * the high word holds fields 0-9 and min(size, 10), the low word
+ * fields 10-19 and the number of fields beyond 10.  Comparing the high
+ * words and then the low words orders identifiers lexicographically by
+ * field, just as VolumeIdentifier::operator< does.  For an identifier
+ * of at most 10 fields the high word equals the packedKey() of the
+ * corresponding VolumeIdentifier and the low word is 0, so conversion
+ * in that case is lossless both ways.
+ *
+ * Only the depth limit is lifted: fields are limited to
+ * VolumeIdentifier::maxFieldValue() (63), as before, so that the high
+ * word keeps the layout of packedKey().  Values beyond that, such as
+ * tracker strip numbers, cannot be held as one field; store them
+ * alongside the identifier (TkrStripId does so for strips) or split
+ * them over two fields.
+ */
+class WideVolumeIdentifier {
+public:
+  typedef VolumeIdentifier::uint64 uint64;
+
+  WideVolumeIdentifier() : m_hi(0), m_lo(0) {}
+
+  explicit WideVolumeIdentifier(const VolumeIdentifier& id)
+    : m_hi(id.packedKey()), m_lo(0) {}
+
+  /// true if the identifier has at most 10 fields, so that
+  /// volumeId() can represent it
+  bool fits64() const {return m_lo == 0;}
+
+  /// The equivalent VolumeIdentifier; throws std::range_error unless
+  /// fits64()
+  VolumeIdentifier volumeId() const {
+    if (!fits64()) {
+      throw std::range_error
+        ("WideVolumeIdentifier::volumeId: too many fields");
+    }
+    return VolumeIdentifier::fromPackedKey(m_hi);
+  }
+
+  int size() const {return (int) ((m_hi & 0xf) + (m_lo & 0xf));}
+
+  /// Max number of fields in an identifier
+  static unsigned maxSize() {return 2 * s_wordSize;}
+
+  /// access single ids which constitute the volume identifier
+  unsigned int operator[](unsigned int index) const {
+    const uint64 word = (index < s_wordSize) ? m_hi : m_lo;
+    return (unsigned int)
+      (word >> (VolumeIdentifier::fieldShift(index % s_wordSize) + 4)) &
+      VolumeIdentifier::maxFieldValue();
+  }
+
+  /// Append a field; throws std::range_error if the identifier is
+  /// already of maximum size or @a id is beyond
+  /// VolumeIdentifier::maxFieldValue()
+  inline void append(unsigned int id);
+
+  /// append, at the end, another id; throws std::range_error if the
+  /// result would be too long
+  void append(const WideVolumeIdentifier& id);
+
+  /// prepend, in front, another id; throws as append()
+  void prepend(const WideVolumeIdentifier& id);
+
+  /// Name in the form of VolumeIdentifier::name()
+  std::string name(const char* delimiter = "/") const;
+
+  /// As VolumeIdentifier::parse(), allowing up to maxSize() fields
+  static VolumeIdentifier::Status parse(const char* text, std::size_t len,
+                                        WideVolumeIdentifier& id,
+                                        const char* delimiter = "/");
+
+  static VolumeIdentifier::Status parse(const std::string& text,
+                                        WideVolumeIdentifier& id,
+                                        const char* delimiter = "/") {
+    return parse(text.data(), text.size(), id, delimiter);
+  }
+
+  // Subsystem fields all lie in the first ten, held by the high word
+  typedef VolumeIdentifier::SubsystemSelect SubsystemSelect;
+  bool isTkr(const SubsystemSelect& sel = 
+             VolumeIdentifier::builtinSelect()) const {
+    return head().isTkr(sel);
+  }
+  bool isCal(const SubsystemSelect& sel = 
+             VolumeIdentifier::builtinSelect()) const {
+    return head().isCal(sel);
+  }
+  bool isAcd(const SubsystemSelect& sel = 
+             VolumeIdentifier::builtinSelect()) const {
+    return head().isAcd(sel);
+  }
+  VolumeIdentifier::Subsystem classify(const SubsystemSelect& sel = 
+                                       VolumeIdentifier::builtinSelect()) const {
+    return head().classify(sel);
+  }
+
+  /// true if this identifier is @a prefix or lies beneath it
+  bool isDescendantOf(const WideVolumeIdentifier& prefix) const;
+
+  /// The two words; together a unique key ordered like operator<
+  uint64 highWord() const {return m_hi;}
+  uint64 lowWord() const {return m_lo;}
+
+  static WideVolumeIdentifier fromWords(uint64 hi, uint64 lo) {
+    WideVolumeIdentifier id;
+    id.m_hi = hi;
+    id.m_lo = lo;
+    return id;
+  }
+
+  // Two-word compares, combined without branching
+  bool operator<(const WideVolumeIdentifier& o) const {
+    return (m_hi < o.m_hi) | ((m_hi == o.m_hi) & (m_lo < o.m_lo));
+  }
+  bool operator==(const WideVolumeIdentifier& o) const {
+    return ((m_hi ^ o.m_hi) | (m_lo ^ o.m_lo)) == 0;
+  }
+  bool operator!=(const WideVolumeIdentifier& o) const {
+    return !(*this == o);
+  }
+
+private:
+  /// Fields per word
+  static const unsigned s_wordSize = 10;
+
+  /// The first (up to) ten fields
+  VolumeIdentifier head() const {return VolumeIdentifier::fromPackedKey(m_hi);}
+
+  /// Fields 0-9 and min(size, 10)
+  uint64 m_hi;
+  /// Fields 10-19 and max(size - 10, 0)
+  uint64 m_lo;
+};
+
+// inline declarations
+
+inline void WideVolumeIdentifier::append(unsigned int id)
+{
+  const unsigned size = this->size();
+  if (size >= maxSize()) {
+    throw std::range_error
+      ("WideVolumeIdentifier::append: id is already of maximum size");
+  }
+  else if (id > VolumeIdentifier::maxFieldValue()) {
+    throw std::range_error
+      ("WideVolumeIdentifier::append: new field value is too large");
+  }
+  uint64& word = (size < s_wordSize) ? m_hi : m_lo;
+  word |= (uint64) id << (VolumeIdentifier::fieldShift(size % s_wordSize) + 4);
+  word++;
+}
+
+/// Hash function object for WideVolumeIdentifier
+struct WideVolumeIdentifierHash {
+  std::size_t operator()(const WideVolumeIdentifier& id) const {
+    return VolumeIdentifierHash::mix
+      (id.highWord() ^ VolumeIdentifierHash::mix(id.lowWord()));
+  }
+};
+
+}
+
+#if __cplusplus >= 201103L
+#include <functional>
+namespace std {
+  template <> struct hash<idents::WideVolumeIdentifier>
+    : public idents::WideVolumeIdentifierHash {};
+}
+#endif
+
+#endif
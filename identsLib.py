@@ -1,7 +1,53 @@
 #$Header: /nfs/slac/g/glast/ground/cvs/GlastRelease-scons/idents/identsLib.py,v 1.1 2008/07/09 21:13:47 glastrm Exp $
+
+# OpenMP flag found for each compiler, '' if it has none
+_openmpFlags = {}
+
+def _checkOpenMP(context, flag):
+    context.Message('Checking whether %s enables OpenMP... ' % flag)
+    oldCcFlags = list(context.env.get('CCFLAGS', []))
+    oldLinkFlags = list(context.env.get('LINKFLAGS', []))
+    context.env.AppendUnique(CCFLAGS = [flag])
+    if flag != '/openmp': context.env.AppendUnique(LINKFLAGS = [flag])
+    ok = context.TryLink('#include <omp.h>\n'
+                         '#ifndef _OPENMP\n#error no OpenMP\n#endif\n'
+                         'int main() {return omp_get_max_threads() < 1;}\n',
+                         '.cxx')
+    context.env.Replace(CCFLAGS = oldCcFlags, LINKFLAGS = oldLinkFlags)
+    context.Result(ok)
+    return ok
+
+def openmpFlag(env):
+    """Flag turning on OpenMP for the compiler of env, or ''"""
+    cxx = env.subst('$CXX')
+    if cxx not in _openmpFlags:
+        flag = '-fopenmp'
+        if env['PLATFORM'] == 'win32': flag = '/openmp'
+        conf = env.Clone().Configure(custom_tests = {'CheckOpenMP' : _checkOpenMP})
+        if not conf.CheckOpenMP(flag): flag = ''
+        conf.Finish()
+        _openmpFlags[cxx] = flag
+    return _openmpFlags[cxx]
+
+def addOpenMP(env, compile):
+    """Compile (if compile) and link env with OpenMP, where the compiler
+    has it.  Only the radix sort source is compiled with it; programs
+    calling radixSort() link with it by asking for identsLib with
+    openmp = 1"""
+    if env.GetOption('clean') or env.GetOption('help'): return
+    flag = openmpFlag(env)
+    if flag == '': return
+    if compile: env.AppendUnique(CCFLAGS = [flag])
+    if flag != '/openmp': env.AppendUnique(LINKFLAGS = [flag])
+
 def generate(env, **kw):
+    if kw.get('openmpCompile', 0):
+        addOpenMP(env, 1)
+        return
+
     if not kw.get('depsOnly', 0):
         env.Tool('addLibrary', library = ['idents'])
+        if kw.get('openmp', 0): addOpenMP(env, 0)
 
         if env['PLATFORM'] == "win32" and env.get('CONTAINERNAME','') == 'GlastRelease':
             env.Tool('findPkgPath', package = 'idents') 
@@ -11,6 +11,7 @@
 // Include files
 #include "idents/AcdId.h"
 #include "idents/AcdConv.h"
+#include "idents/BitFieldLayout.h"
 #include "facilities/Util.h"
 #include <stdexcept>
 #include <iostream>
@@ -18,30 +19,32 @@
 
 using namespace idents; 
 
-/** Constructor from VolumeIdentifier.  Assuming a particular form for
-    fields within VolumeIdentifier (correct as of Oct 20, 2004):
+/** Constructor from VolumeIdentifier.  Field positions are taken from
+    the installed VolumeIdSchema (built-in form correct as of Oct 20, 2004):
 */
 AcdId::AcdId(const VolumeIdentifier& vId) : m_id(0) {
   constructorGuts(vId);
 }
 
 void AcdId::constructorGuts(const VolumeIdentifier& volId)   {
+    typedef VolumeIdSchema Schema;
 
     na(0);
     if (!checkVolId(volId)) throw std::invalid_argument("VolumeIdentifier");
 
-    if (volId[2] == tileVolId) {
-        face(volId[1]);
+    unsigned type = Schema::get(volId, Schema::fAcdType);
+    if (type == Schema::value(Schema::eAcdTile)) {
+        face(Schema::get(volId, Schema::fAcdFace));
         /* as of revised ACD geometry (nov ?? 2002) row and column
         are always in the right order, but there is an intervening
         field which has to be thrown away. For now it should always
         have value 40 (tile).  When ribbons are sensitive, will also see
         41 if volume refers to a ribbon.  */
-        row(volId[3]);
-        column(volId[4]);
-    } else if (volId[2] == ribbonVolId) {
-        ribbonNum(volId[4]);
-        ribbonOrientation(6-volId[3]);
+        row(Schema::get(volId, Schema::fAcdRow));
+        column(Schema::get(volId, Schema::fAcdColumn));
+    } else if (type == Schema::value(Schema::eAcdRibbon)) {
+        ribbonNum(Schema::get(volId, Schema::fAcdRibbonNum));
+        ribbonOrientation(6-Schema::get(volId, Schema::fAcdRibbonOrient));
     }
 
 }
@@ -86,7 +89,18 @@ unsigned int AcdId::indexFromTile(unsigned int tile) {
 }
   
 
+const BitFieldLayout& AcdId::layout() {
+  static const unsigned char shifts[numFields] =
+    {colShift, rowShift, faceShift, naShift};
+  static const unsigned char widths[numFields] = {4, 4, 3, 2};
+  static const BitFieldLayout fields(numFields, shifts, widths);
+  return fields;
+}
 
+void AcdId::unpack(unsigned char* fields) const {
+  layout().unpack(m_id, fields);
+}
 
-
-
+void AcdId::pack(const unsigned char* fields) {
+  m_id = (unsigned int) layout().pack(fields);
+}
@@ -0,0 +1,147 @@
+// File and Version Information:
+//      \$Header\$
+//
+// Description:
+//      Multi-field extract and insert, by pext/pdep where the processor
+//      does them quickly and by shifts and masks elsewhere.
+
+#include "idents/BitFieldLayout.h"
+#include <stdexcept>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define IDENTS_BMI2_DISPATCH
+#define IDENTS_BMI2_TARGET __attribute__((target("bmi2")))
+#include <immintrin.h>
+#include <cpuid.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define IDENTS_BMI2_DISPATCH
+#define IDENTS_BMI2_TARGET
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+using namespace idents;
+
+namespace {
+  typedef BitFieldLayout::uint64 uint64;
+
+#ifdef IDENTS_BMI2_DISPATCH
+  /// Leaves 0, 1 and 7 (subleaf 0); false if the processor does not
+  /// have the leaf
+  bool cpuid(unsigned leaf, unsigned regs[4])
+  {
+#if defined(__GNUC__)
+    if (__get_cpuid_max(0, 0) < leaf) return false;
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#else
+    int r[4];
+    __cpuid(r, 0);
+    if ((unsigned) r[0] < leaf) return false;
+    __cpuidex(r, (int) leaf, 0);
+    for (int i = 0; i < 4; i++) regs[i] = (unsigned) r[i];
+#endif
+    return true;
+  }
+
+  // BMI2 is leaf 7 EBX bit 8.  AMD before family 19h (Zen 3) runs
+  // pext/pdep in microcode taking tens to hundreds of cycles, so it
+  // is treated as not having them.
+  bool detectBmi2()
+  {
+    unsigned regs[4];
+    if (!cpuid(7, regs) || !(regs[1] & (1u << 8))) return false;
+    cpuid(0, regs);
+    const bool amd = (regs[1] == 0x68747541) &&   // "Auth"
+      (regs[3] == 0x69746e65) && (regs[2] == 0x444d4163);  // "enti" "cAMD"
+    if (!amd) return true;
+    cpuid(1, regs);
+    unsigned family = (regs[0] >> 8) & 0xf;
+    if (family == 0xf) family += (regs[0] >> 20) & 0xff;
+    return family >= 0x19;
+  }
+
+  IDENTS_BMI2_TARGET
+  uint64 unpackBmi2(uint64 word, uint64 mask, uint64 laneMask)
+  {
+    return _pdep_u64(_pext_u64(word, mask), laneMask);
+  }
+
+  IDENTS_BMI2_TARGET
+  uint64 packBmi2(uint64 lanes, uint64 mask, uint64 laneMask)
+  {
+    return _pdep_u64(_pext_u64(lanes, laneMask), mask);
+  }
+#else
+  bool detectBmi2() {return false;}
+#endif
+}
+
+bool BitFieldLayout::s_bmi2 = detectBmi2();
+
+bool BitFieldLayout::useBmi2(bool enable)
+{
+  s_bmi2 = enable && detectBmi2();
+  return s_bmi2;
+}
+
+BitFieldLayout::BitFieldLayout(unsigned n, const unsigned char* shifts,
+                               const unsigned char* widths)
+  : m_count(n), m_descending(false), m_mask(0), m_laneMask(0)
+{
+  if ((n < 1) || (n > maxFields)) {
+    throw std::invalid_argument("BitFieldLayout: bad number of fields");
+  }
+  m_descending = (n > 1) && (shifts[1] < shifts[0]);
+  for (unsigned k = 0; k < n; k++) {
+    if ((widths[k] < 1) || (widths[k] > 8) ||
+        (shifts[k] + widths[k] > 64)) {
+      throw std::invalid_argument("BitFieldLayout: bad field width");
+    }
+    if (k > 0) {
+      const unsigned lo = m_descending ? k : k - 1;
+      const unsigned hi = m_descending ? k - 1 : k;
+      if (shifts[lo] + widths[lo] > shifts[hi]) {
+        throw std::invalid_argument
+          ("BitFieldLayout: fields overlap or are out of order");
+      }
+    }
+    m_shift[k] = shifts[k];
+    m_width[k] = widths[k];
+    m_mask |= (((uint64) 1 << widths[k]) - 1) << shifts[k];
+    // pext packs fields lowest first
+    const unsigned lane = m_descending ? n - 1 - k : k;
+    m_laneMask |= (((uint64) 1 << widths[k]) - 1) << (8 * lane);
+  }
+}
+
+BitFieldLayout::uint64 BitFieldLayout::unpack(uint64 word) const
+{
+#ifdef IDENTS_BMI2_DISPATCH
+  if (s_bmi2) {
+    uint64 lanes = unpackBmi2(word, m_mask, m_laneMask);
+    return m_descending ? reverseLanes(lanes) : lanes;
+  }
+#endif
+  uint64 lanes = 0;
+  for (unsigned k = 0; k < m_count; k++) {
+    lanes |= ((word >> m_shift[k]) & (((uint64) 1 << m_width[k]) - 1))
+      << (8 * k);
+  }
+  return lanes;
+}
+
+BitFieldLayout::uint64 BitFieldLayout::pack(uint64 lanes) const
+{
+#ifdef IDENTS_BMI2_DISPATCH
+  if (s_bmi2) {
+    return packBmi2(m_descending ? reverseLanes(lanes) : lanes,
+                    m_mask, m_laneMask);
+  }
+#endif
+  uint64 word = 0;
+  for (unsigned k = 0; k < m_count; k++) {
+    word |= ((lanes >> (8 * k)) & (((uint64) 1 << m_width[k]) - 1))
+      << m_shift[k];
+  }
+  return word;
+}
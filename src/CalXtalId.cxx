@@ -25,12 +25,15 @@
 // Include files
 #include "idents/CalXtalId.h"
 #include "idents/VolumeIdentifier.h"
+#include "idents/VolumeIdSchema.h"
+#include "idents/BitFieldLayout.h"
 #include <stdexcept>
 
 using namespace idents; 
 
-// Constructor from VolumeIdentifier.  Assuming a particular form for
-// fields within VolumeIdentifier (correct as of June 14, 2004):
+// Constructor from VolumeIdentifier.  Field positions are taken from
+// the installed VolumeIdSchema; the built-in one has (correct as of
+// June 14, 2004):
 //    field 0 is fLATObjects; check for value = 0 (towers)
 //    field 1 is y-value for tower 
 //    field 2 is x-value for tower
@@ -39,26 +42,18 @@ using namespace idents;
 //    field 5 is orientation (measures X or Y)
 //    field 6 log number ("column" in CalXtalId terms)
 CalXtalId::CalXtalId(const VolumeIdentifier& vId, unsigned xNum) {
-    const int minSize = 7;
-    const unsigned LATObjectTower = 0;
-    const unsigned TowerObjectCal = 0;
-    enum {
-        fLATObjects = 0,
-        fTowerY = 1,
-        fTowerX = 2,
-        fTowerObjects = 3,
-        fLayer = 4,
-        fMeasure = 5, 
-        fCALLog = 6
-    };
-    if (vId.size() < minSize) throw std::invalid_argument("VolumeIdentifier");
-    if ((vId[fLATObjects] != LATObjectTower) || 
-        (vId[fTowerObjects] != TowerObjectCal)) {
+    typedef VolumeIdSchema Schema;
+    if (!vId.isCal(Schema::select()) || !Schema::has(vId, Schema::fTowerY) ||
+        !Schema::has(vId, Schema::fTowerX) || 
+        !Schema::has(vId, Schema::fCalLayer) ||
+        !Schema::has(vId, Schema::fCalLog)) {
         throw std::invalid_argument("VolumeIdentifier");
     }
-    if (vId[fTowerX] >= xNum) throw std::invalid_argument("xNum");
-    short tower = xNum*vId[fTowerY] + vId[fTowerX];
-    packId(tower, vId[fLayer], vId[fCALLog], FACE_UNUSED, RANGE_UNUSED);
+    unsigned towerX = Schema::get(vId, Schema::fTowerX);
+    if (towerX >= xNum) throw std::invalid_argument("xNum");
+    short tower = xNum*Schema::get(vId, Schema::fTowerY) + towerX;
+    packId(tower, Schema::get(vId, Schema::fCalLayer), 
+           Schema::get(vId, Schema::fCalLog), FACE_UNUSED, RANGE_UNUSED);
 }
 
 /*
@@ -77,24 +72,20 @@ http://www.slac.stanford.edu/exp/glast/ground/software/geometry/docs/identifiers
 
 */
 VolumeIdentifier* CalXtalId::makeVolumeId() const {
+  typedef VolumeIdSchema Schema;
   VolumeIdentifier* vid = new VolumeIdentifier;
-  vid->append(0);   // LATObjects
+  Schema::set(*vid, Schema::fLATObjects, Schema::value(Schema::eLATTowers));
   int fld = getTower();
   int towerY = fld/4;
   int towerX = fld - (4*towerY);
-  vid->append(towerY);
-  vid->append(towerX);
-  vid->append(0);       // towerCAL
-  fld = getLayer();
-  vid->append(fld);
-  if (isX()) {
-    vid->append(0);
-  } else {
-    vid->append(1);
-  }
-  fld = getColumn();
-  vid->append(fld);
-  vid->append(0);   // only return vid's for crystals
+  Schema::set(*vid, Schema::fTowerY, towerY);
+  Schema::set(*vid, Schema::fTowerX, towerX);
+  Schema::set(*vid, Schema::fTowerObjects, Schema::value(Schema::eTowerCAL));
+  Schema::set(*vid, Schema::fCalLayer, getLayer());
+  Schema::set(*vid, Schema::fCalMeasure, isX() ? 0 : 1);
+  Schema::set(*vid, Schema::fCalLog, getColumn());
+  // only return vid's for crystals
+  Schema::set(*vid, Schema::fCalCellCmp, 0);
   return vid;
 }
 
@@ -127,3 +118,24 @@ void CalXtalId::getUnpackedId(short& tower, short& layer, short& column)
 }
 
 
+// retrieve or set all fields at once
+const BitFieldLayout& CalXtalId::layout()
+{
+    static const unsigned char shifts[N_FIELDS] = {
+        COLUMN_SHIFT, LAYER_SHIFT, TOWER_SHIFT, FACE_SHIFT,
+        FACE_VALID_SHIFT, RANGE_SHIFT, RANGE_VALID_SHIFT
+    };
+    static const unsigned char widths[N_FIELDS] = {4, 3, 4, 1, 1, 2, 1};
+    static const BitFieldLayout fields(N_FIELDS, shifts, widths);
+    return fields;
+}
+
+void CalXtalId::unpack(unsigned char* fields) const
+{
+    layout().unpack(m_packedId, fields);
+}
+
+void CalXtalId::pack(const unsigned char* fields)
+{
+    m_packedId = (unsigned int) layout().pack(fields);
+}
@@ -0,0 +1,105 @@
+// File and Version Information:
+//      \$Header\$
+//
+// Description:
+//      32-bit form of VolumeIdentifier with per-subsystem field widths
+//      taken from the installed VolumeIdSchema.
+
+#include "idents/CompactVolumeId.h"
+#include "idents/VolumeIdSchema.h"
+#include <stdexcept>
+
+using namespace idents;
+
+namespace {
+  typedef VolumeIdSchema::CompactLayout Layout;
+
+  /// Packed form of @a vid, or false if it does not fit
+  inline bool pack(const VolumeIdentifier& vid, unsigned int& packed) {
+    const VolumeIdentifier::Subsystem s = vid.classify(VolumeIdSchema::select());
+    const Layout& layout = VolumeIdSchema::compactLayout(s);
+    const unsigned size = vid.size();
+    if ((s == VolumeIdentifier::eOther) || (size > layout.levels)) {
+      return false;
+    }
+    const VolumeIdentifier::int64 value = vid.getValue();
+    unsigned int key = size;
+    unsigned int overflow = 0;
+    for (unsigned i = 0; i < size; i++) {
+      unsigned int field = (value >> VolumeIdentifier::fieldShift(i)) &
+        VolumeIdentifier::maxFieldValue();
+      overflow |= field >> layout.width[i];
+      key |= field << layout.shift[i];
+    }
+    if (overflow) return false;
+    packed = key;
+    return true;
+  }
+
+  /// Layout used for @a packed: the fields telling subsystems apart
+  /// sit at the same place in all layouts
+  inline const Layout& layoutOf(unsigned int packed) {
+    typedef VolumeIdSchema Schema;
+    const Layout& tkr = Schema::compactLayout(VolumeIdentifier::eTkr);
+    const unsigned lat = Schema::index(Schema::fLATObjects);
+    const unsigned latValue = (packed >> tkr.shift[lat]) &
+      ((1u << tkr.width[lat]) - 1);
+    if (latValue == Schema::value(Schema::eLATACD)) {
+      return Schema::compactLayout(VolumeIdentifier::eAcd);
+    }
+    const unsigned tower = Schema::index(Schema::fTowerObjects);
+    const unsigned towerValue = (packed >> tkr.shift[tower]) &
+      ((1u << tkr.width[tower]) - 1);
+    return (towerValue == Schema::value(Schema::eTowerTKR)) ? tkr :
+      Schema::compactLayout(VolumeIdentifier::eCal);
+  }
+
+  inline VolumeIdentifier unpack(unsigned int packed) {
+    const Layout& layout = layoutOf(packed);
+    unsigned size = packed & 0xf;
+    if (size > layout.levels) size = layout.levels;
+    VolumeIdentifier::int64 value = 0;
+    for (unsigned i = 0; i < size; i++) {
+      VolumeIdentifier::int64 field = (packed >> layout.shift[i]) &
+        ((1u << layout.width[i]) - 1);
+      value |= field << VolumeIdentifier::fieldShift(i);
+    }
+    VolumeIdentifier vid;
+    vid.init(value, size);
+    return vid;
+  }
+}
+
+CompactVolumeId::CompactVolumeId(const VolumeIdentifier& vid)
+{
+  if (!pack(vid, m_packedId)) {
+    throw std::invalid_argument("CompactVolumeId: VolumeIdentifier " +
+                                vid.name() + " does not fit");
+  }
+}
+
+bool CompactVolumeId::fromVolumeId(const VolumeIdentifier& vid,
+                                   CompactVolumeId& out)
+{
+  return pack(vid, out.m_packedId);
+}
+
+VolumeIdentifier CompactVolumeId::volumeId() const
+{
+  return unpack(m_packedId);
+}
+
+std::size_t CompactVolumeId::compact(const VolumeIdentifier* ids,
+                                     std::size_t n, CompactVolumeId* out)
+{
+  for (std::size_t i = 0; i < n; i++) {
+    if (!pack(ids[i], out[i].m_packedId)) return i;
+  }
+  return n;
+}
+
+void CompactVolumeId::expand(const CompactVolumeId* ids, std::size_t n,
+                             VolumeIdentifier* out)
+{
+  for (std::size_t i = 0; i < n; i++) out[i] = unpack(ids[i].m_packedId);
+}
@@ -0,0 +1,81 @@
+// File and Version Information:
+//      \$Header\$
+//
+// Description:
+//      Choice, at startup, of the vector kernels used by the batch
+//      operations, from cpuid and the register state the operating
+//      system saves (XCR0).
+
+#include "idents/SimdLevel.h"
+#include "VolumeIdSimd.h"
+
+#if defined(IDENTS_SIMD_KERNELS) && defined(__GNUC__)
+#include <cpuid.h>
+#endif
+
+using namespace idents;
+
+namespace {
+#ifdef IDENTS_SIMD_KERNELS
+  /// Leaf @a leaf, subleaf 0; false if the processor does not have it
+  bool cpuid(unsigned leaf, unsigned regs[4])
+  {
+#if defined(__GNUC__)
+    if (__get_cpuid_max(0, 0) < leaf) return false;
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#else
+    int r[4];
+    __cpuid(r, 0);
+    if ((unsigned) r[0] < leaf) return false;
+    __cpuidex(r, (int) leaf, 0);
+    for (int i = 0; i < 4; i++) regs[i] = (unsigned) r[i];
+#endif
+    return true;
+  }
+
+  /// Register state enabled by the operating system
+  unsigned xcr0()
+  {
+#if defined(__GNUC__)
+    unsigned lo, hi;
+    __asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return lo;
+#else
+    return (unsigned) _xgetbv(0);
+#endif
+  }
+
+  // AVX2 is leaf 7 EBX bit 5 and AVX-512F bit 16.  Both need the
+  // operating system to save the wider registers: XCR0 bits 1-2 (SSE
+  // and AVX state) and, for AVX-512, bits 5-7 as well; OSXSAVE (leaf 1
+  // ECX bit 27) says XCR0 may be read.
+  SimdLevel::Level detect()
+  {
+    unsigned regs[4];
+    if (!cpuid(1, regs) || !(regs[2] & (1u << 27))) return SimdLevel::eScalar;
+    const unsigned state = xcr0();
+    if ((state & 0x6) != 0x6) return SimdLevel::eScalar;
+    if (!cpuid(7, regs) || !(regs[1] & (1u << 5))) return SimdLevel::eScalar;
+    if ((regs[1] & (1u << 16)) && ((state & 0xe6) == 0xe6)) {
+      return SimdLevel::eAvx512;
+    }
+    return SimdLevel::eAvx2;
+  }
+#else
+  SimdLevel::Level detect() {return SimdLevel::eScalar;}
+#endif
+}
+
+SimdLevel::Level SimdLevel::s_level = SimdLevel::detected();
+
+SimdLevel::Level SimdLevel::detected()
+{
+    static const Level level = detect();
+    return level;
+}
+
+SimdLevel::Level SimdLevel::use(Level level)
+{
+    s_level = (level < detected()) ? level : detected();
+    return s_level;
+}
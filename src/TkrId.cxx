@@ -11,14 +11,19 @@
 // Include files
 #include "idents/TkrId.h"
 #include "idents/VolumeIdentifier.h"
+#include "idents/VolumeIdSchema.h"
+#include "idents/BitFieldLayout.h"
+#include "idents/BitOps.h"
+#include "VolumeIdSimd.h"
 #include <stdexcept>
 #include <iostream>
 #include <ios>
 
 using namespace idents; 
 
-/** Constructor from VolumeIdentifier.  Assuming a particular form for
-    fields within VolumeIdentifier (correct as of June 14, 2004):
+/** Constructor from VolumeIdentifier.  Field positions are taken from
+    the installed VolumeIdSchema; the built-in one has (correct as of 
+    June 14, 2004):
     field 0 is fLATObjects; check for value = 0 (towers)
     field 1 is y-value for tower 
     field 2 is x-value for tower
@@ -50,6 +55,54 @@ TkrId::TkrId(unsigned towerX, unsigned towerY, unsigned tray, bool top,
   }
 }
 
+const BitFieldLayout& TkrId::layout() {
+  static const unsigned char shifts[eNumFields] = {
+    SHIFTTowerY, SHIFTTowerX, SHIFTTray, SHIFTMeas, SHIFTBotTop,
+    SHIFTLadder, SHIFTWafer
+  };
+  static const unsigned char widths[eNumFields] = {2, 2, 6, 1, 1, 2, 2};
+  static const BitFieldLayout fields(eNumFields, shifts, widths);
+  return fields;
+}
+
+const BitFieldLayout& TkrId::validLayout() {
+  // The VALID bits lie in reverse field order, one bit each
+  static const unsigned char shifts[eNumFields] = {
+    (unsigned char) bitops::ctz64(VALIDTowerY),
+    (unsigned char) bitops::ctz64(VALIDTowerX),
+    (unsigned char) bitops::ctz64(VALIDTray),
+    (unsigned char) bitops::ctz64(VALIDMeas),
+    (unsigned char) bitops::ctz64(VALIDBotTop),
+    (unsigned char) bitops::ctz64(VALIDLadder),
+    (unsigned char) bitops::ctz64(VALIDWafer)
+  };
+  static const unsigned char widths[eNumFields] = {1, 1, 1, 1, 1, 1, 1};
+  static const BitFieldLayout flags(eNumFields, shifts, widths);
+  return flags;
+}
+
+void TkrId::unpack(unsigned char* fields, unsigned char* valid) const {
+  // Byte k of validLanes is 1 if field k is valid, 0 if not; times
+  // 0xff that is a mask clearing the fields which are not valid,
+  // whatever their bits hold
+  const BitFieldLayout::uint64 validLanes = validLayout().unpack(m_packedId);
+  BitFieldLayout::store(layout().unpack(m_packedId) & (validLanes * 0xff),
+                        fields, eNumFields);
+  if (valid) BitFieldLayout::store(validLanes, valid, eNumFields);
+}
+
+void TkrId::pack(const unsigned char* fields, const unsigned char* valid) {
+  if (!valid) {
+    m_packedId = (unsigned long) layout().pack(fields) | validLayout().mask();
+    return;
+  }
+  const BitFieldLayout::uint64 flags = validLayout().pack(valid);
+  const BitFieldLayout::uint64 validLanes = validLayout().unpack(flags);
+  m_packedId = (unsigned long) 
+    (layout().pack(BitFieldLayout::load(fields, eNumFields) & 
+                   (validLanes * 0xff)) | flags);
+}
+
 // the inserter; expect at most diagnostic use
 void TkrId::write(std::ostream &stream) const
 {
@@ -58,58 +111,179 @@ void TkrId::write(std::ostream &stream) const
 }
 
 void TkrId::constructorGuts(const VolumeIdentifier& vId)   {
-  const int minSize = 4;
-  const unsigned eLATTowers = 0;
-  const unsigned eTowerTKR = 1;
-  enum {
-    fLATObjects = 0,
-    fTowerY = 1,
-    fTowerX = 2,
-    fTowerObjects = 3,
-    fTray = 4,
-    fMeas = 5, 
-    fBotTop = 6,
-    fLadder = 7,
-    fWafer = 8
-  };
-  int vIdSize = vId.size();
-  if (vIdSize < minSize) throw std::invalid_argument("VolumeIdentifier");
-  if ((vId[fLATObjects] != eLATTowers) || 
-      (vId[fTowerObjects] != eTowerTKR)) {
+  if (!packVolumeId(vId, m_packedId)) {
     throw std::invalid_argument("VolumeIdentifier");
   }
-  if ((vId[fTowerY] > 3) || (vId[fTowerX] > 3)) 
-    throw std::invalid_argument("VolumeIdentifier");
-  m_packedId = (vId[fTowerY] << SHIFTTowerY) + (vId[fTowerX] << SHIFTTowerX);
-  m_packedId |= VALIDTowerY + VALIDTowerX;
+}
+
+bool TkrId::packVolumeId(const VolumeIdentifier& vId, unsigned long& packed) {
+  typedef VolumeIdSchema Schema;
+  if (!vId.isTkr(Schema::select()) || !Schema::has(vId, Schema::fTowerY) || 
+      !Schema::has(vId, Schema::fTowerX)) {
+    return false;
+  }
+  unsigned towerY = Schema::get(vId, Schema::fTowerY);
+  unsigned towerX = Schema::get(vId, Schema::fTowerX);
+  if ((towerY > 3) || (towerX > 3)) return false;
+  packed = (towerY << SHIFTTowerY) + (towerX << SHIFTTowerX);
+  packed |= VALIDTowerY + VALIDTowerX;
   
-  if (vIdSize > fTray) {
-    m_packedId |= (vId[fTray] << SHIFTTray);
-    m_packedId |= VALIDTray;
+  if (Schema::has(vId, Schema::fTkrTray)) {
+    packed |= (Schema::get(vId, Schema::fTkrTray) << SHIFTTray);
+    packed |= VALIDTray;
   }
   
-  if (vIdSize > fMeas) {
-    m_packedId |= (vId[fMeas] << SHIFTMeas);
-    m_packedId |= VALIDMeas;
+  if (Schema::has(vId, Schema::fTkrMeasure)) {
+    packed |= (Schema::get(vId, Schema::fTkrMeasure) << SHIFTMeas);
+    packed |= VALIDMeas;
   }
   
-  if (vIdSize > fBotTop) {
-    m_packedId |= (vId[fBotTop] << SHIFTBotTop);
-    m_packedId |= VALIDBotTop;
+  if (Schema::has(vId, Schema::fTkrBotTop)) {
+    packed |= (Schema::get(vId, Schema::fTkrBotTop) << SHIFTBotTop);
+    packed |= VALIDBotTop;
     
-    if (vIdSize > fLadder) {
-      m_packedId |= (vId[fLadder] << SHIFTLadder);
-      m_packedId |= VALIDLadder;
+    if (Schema::has(vId, Schema::fTkrLadder)) {
+      packed |= (Schema::get(vId, Schema::fTkrLadder) << SHIFTLadder);
+      packed |= VALIDLadder;
     }
     
-    if (vIdSize > fWafer) {
-      m_packedId |= (vId[fWafer] << SHIFTWafer);
-      m_packedId |= VALIDWafer;
+    if (Schema::has(vId, Schema::fTkrWafer)) {
+      packed |= (Schema::get(vId, Schema::fTkrWafer) << SHIFTWafer);
+      packed |= VALIDWafer;
     }    
   }
+  return true;
 }
 
+#ifdef IDENTS_SIMD_KERNELS
+namespace {
+  /// What TkrId::build() needs from the schema and the TkrId layout,
+  /// fields in the order of TkrId::unpack()
+  struct BuildTables {
+    VolumeIdentifier::int64 select, pattern, minSize;
+    VolumeIdentifier::int64 index[TkrId::eNumFields];
+    int vidShift[TkrId::eNumFields];
+    int shift[TkrId::eNumFields];
+    VolumeIdentifier::int64 flag[TkrId::eNumFields];
+  };
+
+  /// TkrId::build() of vIds[0..] 4 at a time, the TkrIds stored as
+  /// 64-bit words; returns the number converted and adds the number
+  /// valid to @a nValid
+  IDENTS_TARGET_AVX2
+  std::size_t buildAvx2(const VolumeIdentifier* vIds, std::size_t n,
+                        const BuildTables& t, TkrId* out,
+                        unsigned char* valid, std::size_t& nValid)
+  {
+    const unsigned nFields = TkrId::eNumFields;
+    const __m256i select = _mm256_set1_epi64x(t.select);
+    const __m256i pattern = _mm256_set1_epi64x(t.pattern);
+    const __m256i minSize = _mm256_set1_epi64x(t.minSize);
+    __m128i fieldShift[TkrId::eNumFields], packShift[TkrId::eNumFields];
+    __m256i fieldIndex[TkrId::eNumFields], flag[TkrId::eNumFields];
+    for (unsigned f = 0; f < nFields; f++) {
+      fieldShift[f] = _mm_cvtsi32_si128(t.vidShift[f]);
+      packShift[f] = _mm_cvtsi32_si128(t.shift[f]);
+      fieldIndex[f] = _mm256_set1_epi64x(t.index[f]);
+      flag[f] = _mm256_set1_epi64x(t.flag[f]);
+    }
+    const __m256i fieldMask = 
+      _mm256_set1_epi64x(VolumeIdentifier::maxFieldValue());
+
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      __m256i values, sizes;
+      simd::load4(vIds + i, values, sizes);
+      __m256i has[TkrId::eNumFields], term[TkrId::eNumFields];
+      __m256i towerBits = _mm256_setzero_si256();
+      for (unsigned f = 0; f < nFields; f++) {
+        has[f] = _mm256_cmpgt_epi64(sizes, fieldIndex[f]);
+        __m256i field = 
+          _mm256_and_si256(_mm256_srl_epi64(values, fieldShift[f]), fieldMask);
+        if (f < 2) towerBits = _mm256_or_si256(towerBits, field);
+        term[f] = _mm256_or_si256(_mm256_sll_epi64(field, packShift[f]),
+                                  flag[f]);
+      }
+      // ladder and wafer only below a botTop
+      has[5] = _mm256_and_si256(has[5], has[4]);
+      has[6] = _mm256_and_si256(has[6], has[4]);
 
+      __m256i ok = _mm256_and_si256
+        (_mm256_cmpgt_epi64(sizes, minSize),
+         _mm256_cmpeq_epi64(_mm256_and_si256(values, select), pattern));
+      ok = _mm256_and_si256(ok, _mm256_and_si256(has[0], has[1]));
+      // towerY and towerX at most 3
+      ok = _mm256_and_si256(ok, _mm256_cmpeq_epi64
+        (_mm256_and_si256(towerBits, _mm256_set1_epi64x(~3LL)),
+         _mm256_setzero_si256()));
 
+      __m256i packed = _mm256_or_si256(term[0], term[1]);
+      for (unsigned f = 2; f < nFields; f++) {
+        packed = _mm256_or_si256(packed, _mm256_and_si256(has[f], term[f]));
+      }
+      packed = _mm256_and_si256(packed, ok);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
 
+      const int bits = _mm256_movemask_pd(_mm256_castsi256_pd(ok));
+      for (unsigned k = 0; k < 4; k++) valid[i + k] = (bits >> k) & 1;
+      nValid += bitops::popcount64(bits);
+    }
+    return i;
+  }
+}
+#endif
 
+/** Batch conversion.  The AVX2 version does the same steps as 
+    packVolumeId() for four identifiers at once: each "has" test is a
+    compare of the sizes against the field index, each field a shift
+    and mask of the values, and the tests select which terms are OR-ed
+    in, so there is no branch per identifier.  Field values are OR-ed
+    in unmasked, as packVolumeId() does.
+*/
+std::size_t TkrId::build(const VolumeIdentifier* vIds, std::size_t n,
+                         TkrId* out, unsigned char* valid) {
+  std::size_t nValid = 0;
+  std::size_t i = 0;
+
+#ifdef IDENTS_SIMD_KERNELS
+  typedef VolumeIdSchema Schema;
+  if (simd::layoutOk() && (sizeof(TkrId) == 8) && simd::avx2()) {
+    BuildTables t;
+    // The tracker test of VolumeIdentifier::isTkr(), from the schema
+    const VolumeIdentifier::SubsystemSelect& sel = Schema::select();
+    t.select = sel.towerSelect;
+    t.pattern = sel.tkrPattern;
+    t.minSize = sel.towerMinSize;
+
+    // Fields in order towerY, towerX, tray, measure, botTop, ladder, wafer
+    const Schema::Field fields[eNumFields] = {
+      Schema::fTowerY, Schema::fTowerX, Schema::fTkrTray, 
+      Schema::fTkrMeasure, Schema::fTkrBotTop, Schema::fTkrLadder,
+      Schema::fTkrWafer
+    };
+    const int shifts[eNumFields] = {
+      SHIFTTowerY, SHIFTTowerX, SHIFTTray, SHIFTMeas, SHIFTBotTop,
+      SHIFTLadder, SHIFTWafer
+    };
+    const unsigned long flags[eNumFields] = {
+      VALIDTowerY, VALIDTowerX, VALIDTray, VALIDMeas, VALIDBotTop,
+      VALIDLadder, VALIDWafer
+    };
+    for (unsigned f = 0; f < eNumFields; f++) {
+      t.index[f] = Schema::index(fields[f]);
+      t.vidShift[f] = VolumeIdentifier::fieldShift(t.index[f]);
+      t.shift[f] = shifts[f];
+      t.flag[f] = flags[f];
+    }
+    i = buildAvx2(vIds, n, t, out, valid, nValid);
+  }
+#endif
+
+  for (; i < n; i++) {
+    unsigned long packed = 0;
+    valid[i] = packVolumeId(vIds[i], packed);
+    out[i].m_packedId = valid[i] ? packed : 0;
+    nValid += valid[i];
+  }
+  return nValid;
+}
@@ -0,0 +1,143 @@
+// File and Version Information:
+//      \$Header\$
+//
+// Description:
+//      Struct-of-arrays decoding of TkrIds.  Each column is filled with
+//      a constant shift and mask, several ids at a time with AVX-512 or
+//      AVX2 where SimdLevel allows, and cleared where the field's VALID
+//      bit is not set (the constructors do not mask field values, so a
+//      large value can spill into a neighbouring field).  The VALID bits
+//      are in reverse field order, so the validity column is just those
+//      bits shifted down.
+
+#include "idents/TkrIdColumns.h"
+#include "idents/BitOps.h"
+#include "VolumeIdSimd.h"
+
+#include <cstring>
+
+using namespace idents;
+
+namespace {
+  /// Positions of the fields and VALID bits, worked out by decode()
+  struct Layout {
+    unsigned fieldShift[TkrIdColumns::nFields];
+    unsigned fieldMask[TkrIdColumns::nFields];
+    unsigned validFlagShift[TkrIdColumns::nFields];
+    unsigned validShift;
+    unsigned validMask;
+  };
+
+#ifdef IDENTS_SIMD_KERNELS
+  /// Decode words[0..] 8 at a time into the columns @a col; returns
+  /// the number decoded
+  IDENTS_TARGET_AVX512
+  std::size_t decodeAvx512(const TkrId* ids, std::size_t n,
+                           const Layout& lay, unsigned char* col[])
+  {
+    const unsigned nFields = TkrIdColumns::nFields;
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      const __m512i words = _mm512_loadu_si512(ids + i);
+      for (unsigned f = 0; f < nFields; f++) {
+        // all ones where the field is valid
+        __m512i ok = _mm512_sub_epi64(_mm512_setzero_si512(), 
+          _mm512_and_si512
+          (_mm512_srli_epi64(words, lay.validFlagShift[f]),
+           _mm512_set1_epi64(1)));
+        __m512i v = _mm512_and_si512
+          (_mm512_srli_epi64(words, lay.fieldShift[f]),
+           _mm512_and_si512(ok, _mm512_set1_epi64(lay.fieldMask[f])));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(col[f] + i),
+                         _mm512_cvtepi64_epi8(v));
+      }
+      __m512i v = _mm512_and_si512(_mm512_srli_epi64(words, lay.validShift),
+                                   _mm512_set1_epi64(lay.validMask));
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(col[nFields] + i),
+                       _mm512_cvtepi64_epi8(v));
+    }
+    return i;
+  }
+
+  /// As decodeAvx512(), 4 at a time
+  IDENTS_TARGET_AVX2
+  std::size_t decodeAvx2(const TkrId* ids, std::size_t n,
+                         const Layout& lay, unsigned char* col[])
+  {
+    const unsigned nFields = TkrIdColumns::nFields;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      const __m256i words = 
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ids + i));
+      for (unsigned f = 0; f < nFields; f++) {
+        // all ones where the field is valid
+        __m256i ok = _mm256_sub_epi64(_mm256_setzero_si256(), 
+          _mm256_and_si256
+          (_mm256_srli_epi64(words, lay.validFlagShift[f]),
+           _mm256_set1_epi64x(1)));
+        int packed = simd::lowBytes4(_mm256_and_si256
+          (_mm256_srli_epi64(words, lay.fieldShift[f]),
+           _mm256_and_si256(ok, _mm256_set1_epi64x(lay.fieldMask[f]))));
+        std::memcpy(col[f] + i, &packed, 4);
+      }
+      int packed = simd::lowBytes4(_mm256_and_si256
+        (_mm256_srli_epi64(words, lay.validShift),
+         _mm256_set1_epi64x(lay.validMask)));
+      std::memcpy(col[nFields] + i, &packed, 4);
+    }
+    return i;
+  }
+#endif
+}
+
+void TkrIdColumns::decode(const TkrId* ids, std::size_t n)
+{
+    // Field positions and VALID bits, in the order of TkrId::unpack()
+    const Layout lay = {
+        {TkrId::SHIFTTowerY, TkrId::SHIFTTowerX, TkrId::SHIFTTray,
+         TkrId::SHIFTMeas, TkrId::SHIFTBotTop, TkrId::SHIFTLadder,
+         TkrId::SHIFTWafer},
+        {TkrId::MASKTowerY, TkrId::MASKTowerX, TkrId::MASKTray,
+         TkrId::MASKMeas, TkrId::MASKBotTop, TkrId::MASKLadder,
+         TkrId::MASKWafer},
+        {bitops::ctz64(TkrId::VALIDTowerY), bitops::ctz64(TkrId::VALIDTowerX),
+         bitops::ctz64(TkrId::VALIDTray), bitops::ctz64(TkrId::VALIDMeas),
+         bitops::ctz64(TkrId::VALIDBotTop), bitops::ctz64(TkrId::VALIDLadder),
+         bitops::ctz64(TkrId::VALIDWafer)},
+        // The VALID bits lie together in reverse field order, so
+        // shifted down they are the validity byte, with validBit(f)
+        // for field f
+        bitops::ctz64(TkrId::VALIDWafer),
+        (unsigned) (TkrId::VALIDTowerY | TkrId::VALIDTowerX | 
+                    TkrId::VALIDTray | TkrId::VALIDMeas | TkrId::VALIDBotTop |
+                    TkrId::VALIDLadder | TkrId::VALIDWafer) >> 
+        bitops::ctz64(TkrId::VALIDWafer)
+    };
+
+    m_count = n;
+    m_columns.resize((nFields + 1) * n);
+    if (n == 0) return;
+
+    unsigned char* col[nFields + 1];
+    for (unsigned f = 0; f <= nFields; f++) col[f] = &m_columns[0] + f * n;
+
+    std::size_t i = 0;
+
+#ifdef IDENTS_SIMD_KERNELS
+    // The kernels load TkrIds as 64-bit words
+    if (sizeof(TkrId) == 8) {
+        if (simd::avx512()) i = decodeAvx512(ids, n, lay, col);
+        else if (simd::avx2()) i = decodeAvx2(ids, n, lay, col);
+    }
+#endif
+
+    for (; i < n; i++) {
+        const unsigned long word = ids[i].m_packedId;
+        for (unsigned f = 0; f < nFields; f++) {
+            // as the getters, 0 for fields not valid
+            col[f][i] = ((word >> lay.validFlagShift[f]) & 1) ?
+                ((word >> lay.fieldShift[f]) & lay.fieldMask[f]) : 0;
+        }
+        col[nFields][i] = (word >> lay.validShift) & lay.validMask;
+    }
+}
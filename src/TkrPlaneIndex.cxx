@@ -0,0 +1,55 @@
+// File and Version Information:
+//      \$Header\$
+//
+// Description:
+//      Dense numbering of tracker silicon planes and the tables of planes
+//      above, below, in the other view and in neighbouring towers.
+
+#include "idents/TkrPlaneIndex.h"
+#include <stdexcept>
+
+using namespace idents;
+
+TkrPlaneIndex::TkrPlaneIndex(unsigned nTrays)
+  : m_nTrays(nTrays), m_towerPlanes(4 * nTrays), m_size(nTowers * 4 * nTrays)
+{
+    if (nTrays < 1) {
+        throw std::invalid_argument("TkrPlaneIndex: no trays");
+    }
+    m_above.resize(m_size);
+    m_below.resize(m_size);
+    m_otherView.resize(m_size);
+    m_firstNeighbor.resize(m_size + 1);
+    m_neighbors.clear();
+    for (unsigned plane = 0; plane < m_size; plane++) {
+        // z position (2 * tray + botTop) is plane / 2 within the tower
+        const unsigned z = (plane % m_towerPlanes) >> 1;
+        m_above[plane] = (z + 1 < 2 * m_nTrays) ? plane + 2 : (unsigned) npos;
+        m_below[plane] = (z > 0) ? plane - 2 : (unsigned) npos;
+        m_otherView[plane] = plane ^ 1;
+
+        m_firstNeighbor[plane] = m_neighbors.size();
+        const TowerId tower = this->tower(plane);
+        const unsigned offset = plane % m_towerPlanes;
+        for (unsigned other = 0; other < (unsigned) nTowers; other++) {
+            if ((other == (unsigned) tower.id()) ||
+                !tower.neighbor(TowerId(other))) continue;
+            m_neighbors.push_back(other * m_towerPlanes + offset);
+        }
+    }
+    m_firstNeighbor[m_size] = m_neighbors.size();
+}
+
+unsigned TkrPlaneIndex::index(const TkrId& id) const
+{
+    unsigned towerX, towerY, tray, botTop, view;
+    if (!id.getTowerX(towerX) || !id.getTowerY(towerY) || !id.getTray(tray) ||
+        !id.getBotTop(botTop) || !id.getView(view)) {
+        return npos;
+    }
+    if ((towerX >= (unsigned) TowerId::xNum) ||
+        (towerY >= (unsigned) TowerId::yNum)) {
+        return npos;
+    }
+    return index(TowerId(towerX, towerY), tray, botTop, view);
+}
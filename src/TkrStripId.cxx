@@ -0,0 +1,188 @@
+// File and Version Information:
+//      \$Header\$
+//
+// Description:
+//      Strip-level tracker ids and the batch operations on them: a two
+//      pass radix sort on the 22 bits in use, splitting sorted ids into
+//      runs of neighbouring strips (8 at a time with AVX2, where
+//      SimdLevel allows) and counting strips by plane.
+
+#include "idents/TkrStripId.h"
+#include "idents/TkrPlaneIndex.h"
+#include "idents/BitOps.h"
+#include "VolumeIdSimd.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace idents {
+
+namespace {
+  typedef TkrStripId::uint32 uint32;
+
+  /// Radix digits of 11 bits; two passes cover the 22 bits in use
+  const unsigned s_digitBits = 11;
+  const unsigned s_radix = 1 << s_digitBits;
+
+  /// Does @a word continue the run ending at @a prev?  Repeats do; so
+  /// does the next strip of the same plane, which is prev + 1 unless
+  /// the strip number wrapped to 0 in the next plane.
+  inline bool continues(uint32 prev, uint32 word)
+  {
+    return (word == prev) ||
+      ((word == prev + 1) && ((word & TkrStripId::MASKStrip) != 0));
+  }
+
+#ifdef IDENTS_SIMD_KERNELS
+  /// findStripRuns() from words[i..], 8 at a time, ending @a run and
+  /// starting the next at each break; returns the index reached
+  IDENTS_TARGET_AVX2
+  std::size_t runsAvx2(const uint32* words, std::size_t i, std::size_t n,
+                       TkrStripRun& run, std::vector<TkrStripRun>& runs)
+  {
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i stripMask = _mm256_set1_epi32(TkrStripId::MASKStrip);
+    const __m256i zero = _mm256_setzero_si256();
+    for (; i + 8 <= n; i += 8) {
+      const __m256i word = _mm256_loadu_si256
+        (reinterpret_cast<const __m256i*>(words + i));
+      const __m256i prev = _mm256_loadu_si256
+        (reinterpret_cast<const __m256i*>(words + i - 1));
+      // sorted: word >= prev, unsigned
+      const __m256i ordered =
+        _mm256_cmpeq_epi32(_mm256_max_epu32(word, prev), word);
+      const __m256i next = _mm256_andnot_si256
+        (_mm256_cmpeq_epi32(_mm256_and_si256(word, stripMask), zero),
+         _mm256_cmpeq_epi32(word, _mm256_add_epi32(prev, one)));
+      const __m256i cont =
+        _mm256_or_si256(_mm256_cmpeq_epi32(word, prev), next);
+      if (_mm256_movemask_ps(_mm256_castsi256_ps(ordered)) != 0xff) {
+        throw std::invalid_argument("findStripRuns: ids not sorted");
+      }
+      unsigned breaks = ~_mm256_movemask_ps(_mm256_castsi256_ps(cont))
+        & 0xff;
+      while (breaks) {
+        const std::size_t pos = i + bitops::ctz64(breaks);
+        run.end = pos;
+        runs.push_back(run);
+        run.begin = pos;
+        breaks &= breaks - 1;
+      }
+    }
+    return i;
+  }
+#endif
+}
+
+TkrStripId::TkrStripId(const TowerId& tower, unsigned tray, unsigned botTop,
+                       unsigned view, unsigned strip)
+{
+    if (((unsigned) tower.id() > MASKTower) || (tray > MASKTray) ||
+        (botTop > MASKBotTop) || (view > MASKView) || (strip > MASKStrip)) {
+        throw std::invalid_argument("TkrStripId: field out of range");
+    }
+    m_word = (tower.id() << SHIFTTower) | (tray << SHIFTTray) |
+        (botTop << SHIFTBotTop) | (view << SHIFTView) | (strip << SHIFTStrip);
+}
+
+TkrStripId::TkrStripId(const TkrId& plane, unsigned strip)
+{
+    unsigned towerX, towerY, tray, botTop, view;
+    if (!plane.getTowerX(towerX) || !plane.getTowerY(towerY) ||
+        !plane.getTray(tray) || !plane.getBotTop(botTop) ||
+        !plane.getView(view)) {
+        throw std::invalid_argument("TkrStripId: TkrId is not a plane");
+    }
+    *this = TkrStripId(TowerId(towerX, towerY), tray, botTop, view, strip);
+}
+
+void radixSort(TkrStripId* ids, std::size_t n)
+{
+    if (n < 256) {
+        std::sort(ids, ids + n);
+        return;
+    }
+    // Both histograms in one read of the input
+    std::vector<std::size_t> counts(2 * s_radix);
+    std::size_t* low = &counts[0];
+    std::size_t* high = &counts[s_radix];
+    for (std::size_t i = 0; i < n; i++) {
+        const uint32 word = ids[i].word();
+        low[word & (s_radix - 1)]++;
+        high[(word >> s_digitBits) & (s_radix - 1)]++;
+    }
+    std::size_t lowPos = 0, highPos = 0;
+    for (unsigned d = 0; d < s_radix; d++) {
+        const std::size_t lowCount = low[d], highCount = high[d];
+        low[d] = lowPos;
+        high[d] = highPos;
+        lowPos += lowCount;
+        highPos += highCount;
+    }
+    std::vector<TkrStripId> buffer(n);
+    for (std::size_t i = 0; i < n; i++) {
+        buffer[low[ids[i].word() & (s_radix - 1)]++] = ids[i];
+    }
+    for (std::size_t i = 0; i < n; i++) {
+        const uint32 word = buffer[i].word();
+        ids[high[(word >> s_digitBits) & (s_radix - 1)]++] = buffer[i];
+    }
+}
+
+void radixSort(std::vector<TkrStripId>& ids)
+{
+    if (!ids.empty()) radixSort(&ids[0], ids.size());
+}
+
+std::size_t findStripRuns(const TkrStripId* ids, std::size_t n,
+                          std::vector<TkrStripRun>& runs)
+{
+    runs.clear();
+    if (n == 0) return 0;
+    TkrStripRun run;
+    run.begin = 0;
+    std::size_t i = 1;
+
+#ifdef IDENTS_SIMD_KERNELS
+    if ((sizeof(TkrStripId) == 4) && simd::avx2()) {
+        i = runsAvx2(reinterpret_cast<const uint32*>(ids), i, n, run, runs);
+    }
+#endif
+
+    for (; i < n; i++) {
+        const uint32 prev = ids[i - 1].word(), word = ids[i].word();
+        if (word < prev) {
+            throw std::invalid_argument("findStripRuns: ids not sorted");
+        }
+        if (!continues(prev, word)) {
+            run.end = i;
+            runs.push_back(run);
+            run.begin = i;
+        }
+    }
+    run.end = n;
+    runs.push_back(run);
+    return runs.size();
+}
+
+std::size_t countStripsPerPlane(const TkrStripId* ids, std::size_t n,
+                                const TkrPlaneIndex& planes,
+                                std::vector<unsigned>& counts)
+{
+    counts.assign(planes.size(), 0);
+    // Tray, botTop and view, in the low 7 bits of planeKey(), are
+    // tray * 4 + botTop * 2 + view, as in the TkrPlaneIndex numbering
+    const unsigned nTrays = planes.nTrays();
+    const unsigned towerPlanes = 4 * nTrays;
+    std::size_t skipped = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        const TkrStripId id = ids[i];
+        if (id.getTray() >= nTrays) {
+            skipped++;
+            continue;
+        }
+        counts[id.getTower().id() * towerPlanes + (id.planeKey() & 0x7f)]++;
+    }
+    return skipped;
+}
+
+}
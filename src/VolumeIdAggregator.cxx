@@ -0,0 +1,83 @@
+// File and Version Information:
+//      \$Header\$
+//
+// Description:
+//      Roll-up of values attached to sorted VolumeIdentifiers to several
+//      depths of the hierarchy.  A group at depth d ends where the
+//      identifier value masked to its first d fields changes.
+
+#include "idents/VolumeIdAggregator.h"
+#include <stdexcept>
+
+using namespace idents;
+
+VolumeIdAggregator::VolumeIdAggregator(const unsigned* depths, unsigned n)
+{
+    init(depths, n);
+}
+
+VolumeIdAggregator::VolumeIdAggregator(const std::vector<unsigned>& depths)
+{
+    init(depths.empty() ? 0 : &depths[0], depths.size());
+}
+
+void VolumeIdAggregator::init(const unsigned* depths, unsigned n)
+{
+    m_levels.resize(n);
+    for (unsigned k = 0; k < n; k++) {
+        if (depths[k] > VolumeIdentifier::maxSize()) {
+            throw std::invalid_argument
+                ("VolumeIdAggregator: depth beyond VolumeIdentifier::maxSize()");
+        }
+        m_levels[k].depth = depths[k];
+        m_levels[k].mask = VolumeIdentifier::prefixMask(depths[k]);
+    }
+}
+
+inline void VolumeIdAggregator::add(const VolumeIdentifier& id, double x)
+{
+    const VolumeIdentifier::int64 value = id.getValue();
+    for (std::vector<Level>::iterator level = m_levels.begin();
+         level != m_levels.end(); ++level) {
+        if ((unsigned) id.size() < level->depth) continue;
+        std::vector<Group>& groups = level->groups;
+        if (groups.empty() ||
+            (((groups.back().prefix.getValue() ^ value) & level->mask) != 0)) {
+            Group group;
+            group.prefix.init(value & level->mask, level->depth);
+            group.count = 0;
+            group.sum = 0;
+            group.min = group.max = x;
+            groups.push_back(group);
+        }
+        Group& group = groups.back();
+        group.count++;
+        group.sum += x;
+        if (x < group.min) group.min = x;
+        if (x > group.max) group.max = x;
+    }
+}
+
+void VolumeIdAggregator::run(const VolumeIdentifier* ids, const double* values,
+                             std::size_t n)
+{
+    for (unsigned k = 0; k < m_levels.size(); k++) m_levels[k].groups.clear();
+    for (std::size_t i = 0; i < n; i++) {
+        if ((i > 0) && (ids[i] < ids[i - 1])) {
+            throw std::invalid_argument("VolumeIdAggregator: input not sorted");
+        }
+        add(ids[i], values[i]);
+    }
+}
+
+void VolumeIdAggregator::run
+(const std::vector<std::pair<VolumeIdentifier, double> >& data)
+{
+    for (unsigned k = 0; k < m_levels.size(); k++) m_levels[k].groups.clear();
+    for (std::size_t i = 0; i < data.size(); i++) {
+        if ((i > 0) && (data[i].first < data[i - 1].first)) {
+            throw std::invalid_argument("VolumeIdAggregator: input not sorted");
+        }
+        add(data[i].first, data[i].second);
+    }
+}
@@ -0,0 +1,167 @@
+// File and Version Information:
+//      \$Header\$
+//
+// Description:
+//      Batch algorithms over arrays of VolumeIdentifiers.  Where
+//      SimdLevel allows AVX2, identifiers are tested four at a time.  The sorted
+//      set operations compare a block of four from each array, all
+//      pairs at once, then advance whichever block ends lower.
+
+#include "idents/VolumeIdAlgorithms.h"
+#include "VolumeIdSimd.h"
+
+namespace idents {
+
+#ifdef IDENTS_SIMD_KERNELS
+namespace {
+  /// filterDescendants() of ids[0..] 4 at a time, appending to out[nOut..];
+  /// returns the number of ids tested
+  IDENTS_TARGET_AVX2
+  std::size_t filterAvx2(const VolumeIdentifier* ids, std::size_t n,
+                         const VolumeIdentifier& prefix,
+                         VolumeIdentifier* out, std::size_t& nOut)
+  {
+    const __m256i pValue = _mm256_set1_epi64x(prefix.getValue());
+    const __m256i pMask = 
+      _mm256_set1_epi64x(VolumeIdentifier::prefixMask(prefix.size()));
+    const __m256i pSize = _mm256_set1_epi64x(prefix.size());
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      __m256i values, sizes;
+      simd::load4(ids + i, values, sizes);
+      __m256i diff = _mm256_and_si256(_mm256_xor_si256(values, pValue),
+                                      pMask);
+      __m256i keep = 
+        _mm256_andnot_si256(_mm256_cmpgt_epi64(pSize, sizes),
+                            _mm256_cmpeq_epi64(diff,
+                                               _mm256_setzero_si256()));
+      int bits = _mm256_movemask_pd(_mm256_castsi256_pd(keep));
+      if (bits == 0) continue;
+      // Loaded already, so writing over ids[i..i+3] is safe
+      VolumeIdentifier batch[4] = {ids[i], ids[i+1], ids[i+2], ids[i+3]};
+      for (unsigned k = 0; k < 4; k++) {
+        if (bits & (1 << k)) out[nOut++] = batch[k];
+      }
+    }
+    return i;
+  }
+}
+#endif
+
+std::size_t filterDescendants(const VolumeIdentifier* ids, std::size_t n,
+                              const VolumeIdentifier& prefix,
+                              VolumeIdentifier* out)
+{
+    std::size_t nOut = 0;
+    std::size_t i = 0;
+
+#ifdef IDENTS_SIMD_KERNELS
+    if (simd::layoutOk() && simd::avx2()) {
+        i = filterAvx2(ids, n, prefix, out, nOut);
+    }
+#endif
+
+    for (; i < n; i++) {
+        if (ids[i].isDescendantOf(prefix)) out[nOut++] = ids[i];
+    }
+    return nOut;
+}
+
+namespace {
+
+#ifdef IDENTS_SIMD_KERNELS
+  /// Packed keys of 4 identifiers
+  IDENTS_TARGET_AVX2
+  inline __m256i keys4(const VolumeIdentifier* p) {
+    __m256i values, sizes;
+    simd::load4(p, values, sizes);
+    return _mm256_or_si256(_mm256_slli_epi64(values, 4), sizes);
+  }
+
+  /// Lanes of @a a equal to any lane of @a b, as 4 bits
+  IDENTS_TARGET_AVX2
+  inline int matches4(__m256i a, __m256i b) {
+    __m256i eq = _mm256_cmpeq_epi64(a, b);
+    eq = _mm256_or_si256(eq, _mm256_cmpeq_epi64
+                         (a, _mm256_permute4x64_epi64(b, 0x39)));
+    eq = _mm256_or_si256(eq, _mm256_cmpeq_epi64
+                         (a, _mm256_permute4x64_epi64(b, 0x4e)));
+    eq = _mm256_or_si256(eq, _mm256_cmpeq_epi64
+                         (a, _mm256_permute4x64_epi64(b, 0x93)));
+    return _mm256_movemask_pd(_mm256_castsi256_pd(eq));
+  }
+
+  /// setOperation() over whole blocks of 4 from each array, advancing
+  /// @a i and @a j; @a found is left holding the matches of a[i..i+3]
+  /// seen so far.  Returns the number written to @a out
+  IDENTS_TARGET_AVX2
+  std::size_t setBlocksAvx2(const VolumeIdentifier* a, std::size_t na,
+                            const VolumeIdentifier* b, std::size_t nb,
+                            VolumeIdentifier* out, bool keepFound,
+                            std::size_t& i, std::size_t& j, int& found)
+  {
+    std::size_t nOut = 0;
+    __m256i ka = (na >= 4) ? keys4(a) : _mm256_setzero_si256();
+    while ((i + 4 <= na) && (j + 4 <= nb)) {
+      found |= matches4(ka, keys4(b + j));
+      const VolumeIdentifier::uint64 aMax = a[i + 3].packedKey();
+      const VolumeIdentifier::uint64 bMax = b[j + 3].packedKey();
+      if (bMax <= aMax) j += 4;
+      if (aMax <= bMax) {
+        const int keep = keepFound ? found : ~found;
+        for (unsigned k = 0; k < 4; k++) {
+          if (keep & (1 << k)) out[nOut++] = a[i + k];
+        }
+        i += 4;
+        found = 0;
+        if (i + 4 <= na) ka = keys4(a + i);
+      }
+    }
+    return nOut;
+  }
+#endif
+
+  /// Elements of @a a found (if @a keepFound) or not found in @a b
+  std::size_t setOperation(const VolumeIdentifier* a, std::size_t na,
+                           const VolumeIdentifier* b, std::size_t nb,
+                           VolumeIdentifier* out, bool keepFound)
+  {
+    std::size_t nOut = 0;
+    std::size_t i = 0, j = 0;
+    // Elements a[i..i+3] already matched by earlier blocks of b
+    int found = 0;
+
+#ifdef IDENTS_SIMD_KERNELS
+    if (simd::layoutOk() && simd::avx2()) {
+      nOut = setBlocksAvx2(a, na, b, nb, out, keepFound, i, j, found);
+    }
+#endif
+
+    // Any partly matched block of a is finished here too
+    const std::size_t blockStart = i;
+    for (; i < na; i++) {
+      const VolumeIdentifier::uint64 key = a[i].packedKey();
+      while ((j < nb) && (b[j].packedKey() < key)) j++;
+      bool inB = ((j < nb) && (b[j].packedKey() == key));
+      if (i - blockStart < 4) inB |= (found >> (i - blockStart)) & 1;
+      if (inB == keepFound) out[nOut++] = a[i];
+    }
+    return nOut;
+  }
+}
+
+std::size_t intersectSorted(const VolumeIdentifier* a, std::size_t na,
+                            const VolumeIdentifier* b, std::size_t nb,
+                            VolumeIdentifier* out)
+{
+    return setOperation(a, na, b, nb, out, true);
+}
+
+std::size_t differenceSorted(const VolumeIdentifier* a, std::size_t na,
+                             const VolumeIdentifier* b, std::size_t nb,
+                             VolumeIdentifier* out)
+{
+    return setOperation(a, na, b, nb, out, false);
+}
+
+}
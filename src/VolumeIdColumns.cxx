@@ -0,0 +1,95 @@
+// File and Version Information:
+//      \$Header\$
+//
+// Description:
+//      Struct-of-arrays decoding of VolumeIdentifiers.  Each field column
+//      is filled with a constant shift and mask per field, several
+//      identifiers at a time with AVX-512 or AVX2 where SimdLevel
+//      allows.
+
+#include "idents/VolumeIdColumns.h"
+#include "VolumeIdSimd.h"
+
+#include <cstring>
+
+using namespace idents;
+
+#ifdef IDENTS_SIMD_KERNELS
+namespace {
+  typedef VolumeIdColumns Columns;
+
+  /// Decode ids[0..] 8 at a time into the columns @a col; returns the
+  /// number decoded
+  IDENTS_TARGET_AVX512
+  std::size_t decodeAvx512(const VolumeIdentifier* ids, std::size_t n,
+                           unsigned char* col[])
+  {
+    const __m512i vmask = _mm512_set1_epi64(VolumeIdentifier::maxFieldValue());
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      __m512i values, sizes;
+      simd::load8(ids + i, values, sizes);
+      for (unsigned f = 0; f < Columns::nFields; f++) {
+        __m128i count = _mm_cvtsi32_si128(VolumeIdentifier::fieldShift(f));
+        __m512i v = _mm512_and_si512(_mm512_srl_epi64(values, count), vmask);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(col[f] + i),
+                         _mm512_cvtepi64_epi8(v));
+      }
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(col[Columns::nFields] + i),
+                       _mm512_cvtepi64_epi8(sizes));
+    }
+    return i;
+  }
+
+  /// As decodeAvx512(), 4 at a time
+  IDENTS_TARGET_AVX2
+  std::size_t decodeAvx2(const VolumeIdentifier* ids, std::size_t n,
+                         unsigned char* col[])
+  {
+    const __m256i vmask = 
+      _mm256_set1_epi64x(VolumeIdentifier::maxFieldValue());
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      __m256i values, sizes;
+      simd::load4(ids + i, values, sizes);
+      for (unsigned f = 0; f < Columns::nFields; f++) {
+        __m128i count = _mm_cvtsi32_si128(VolumeIdentifier::fieldShift(f));
+        int packed = simd::lowBytes4
+          (_mm256_and_si256(_mm256_srl_epi64(values, count), vmask));
+        std::memcpy(col[f] + i, &packed, 4);
+      }
+      int packed = simd::lowBytes4(sizes);
+      std::memcpy(col[Columns::nFields] + i, &packed, 4);
+    }
+    return i;
+  }
+}
+#endif
+
+void VolumeIdColumns::decode(const VolumeIdentifier* ids, std::size_t n)
+{
+    m_count = n;
+    m_columns.resize((nFields + 1) * n);
+    if (n == 0) return;
+
+    unsigned char* col[nFields + 1];
+    for (unsigned f = 0; f <= nFields; f++) col[f] = &m_columns[0] + f * n;
+
+    const unsigned mask = VolumeIdentifier::maxFieldValue();
+    std::size_t i = 0;
+
+#ifdef IDENTS_SIMD_KERNELS
+    if (simd::layoutOk()) {
+        if (simd::avx512()) i = decodeAvx512(ids, n, col);
+        else if (simd::avx2()) i = decodeAvx2(ids, n, col);
+    }
+#endif
+
+    for (; i < n; i++) {
+        VolumeIdentifier::int64 value = ids[i].getValue();
+        for (unsigned f = 0; f < nFields; f++) {
+            col[f][i] = (value >> VolumeIdentifier::fieldShift(f)) & mask;
+        }
+        col[nFields][i] = ids[i].size();
+    }
+}
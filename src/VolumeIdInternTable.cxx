@@ -0,0 +1,134 @@
+// File and Version Information:
+//      \$Header\$
+//
+// Description:
+//      Minimal perfect hash over a fixed set of VolumeIdentifiers.
+//      Buckets are placed largest first; for each, displacements are
+//      tried in turn until all its keys land in free slots.
+
+#include "idents/VolumeIdInternTable.h"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace idents;
+
+const unsigned int VolumeIdInternTable::notFound;
+
+namespace {
+  /// Average number of keys per bucket
+  const unsigned int keysPerBucket = 3;
+
+  /// Never a valid packed key: size field would be 15
+  const VolumeIdentifier::uint64 noKey = ~0ULL;
+}
+
+void VolumeIdInternTable::clear()
+{
+  m_keys.assign(1, noKey);
+  m_displace.assign(1, 0);
+  m_seed = 0;
+  m_nBuckets = 1;
+  m_nSlots = 1;
+  m_size = 0;
+}
+
+void VolumeIdInternTable::build(const VolumeIdentifier* ids, std::size_t n)
+{
+  clear();
+  if (n == 0) return;
+  if (n >= notFound) {
+    throw std::length_error("VolumeIdInternTable: too many identifiers");
+  }
+
+  std::vector<uint64> keys(n);
+  for (std::size_t i = 0; i < n; i++) keys[i] = ids[i].packedKey();
+  std::vector<uint64> sorted(keys);
+  std::sort(sorted.begin(), sorted.end());
+  std::vector<uint64>::iterator dup =
+    std::adjacent_find(sorted.begin(), sorted.end());
+  if (dup != sorted.end()) {
+    throw std::invalid_argument
+      ("VolumeIdInternTable: duplicate identifier " +
+       VolumeIdentifier::fromPackedKey(*dup).name());
+  }
+
+  // A failure needs a bucket to run out of displacements, which is
+  // very unlikely; a new seed rehashes everything
+  uint64 seed = 0;
+  while (!place(keys, VolumeIdentifierHash::mix(++seed))) {}
+  m_size = n;
+}
+
+bool VolumeIdInternTable::place(const std::vector<uint64>& keys, uint64 seed)
+{
+  const unsigned int n = keys.size();
+  m_seed = seed;
+  m_nSlots = n;
+  m_nBuckets = n / keysPerBucket + 1;
+
+  // Group keys by bucket
+  std::vector<uint64> hashes(n);
+  std::vector<unsigned int> start(m_nBuckets + 1, 0);
+  for (unsigned int i = 0; i < n; i++) {
+    hashes[i] = VolumeIdentifierHash::mix(keys[i] ^ m_seed);
+    start[bucketOf(hashes[i]) + 1]++;
+  }
+  unsigned int maxBucket = 0;
+  for (unsigned int b = 0; b < m_nBuckets; b++) {
+    maxBucket = std::max(maxBucket, start[b + 1]);
+    start[b + 1] += start[b];
+  }
+  std::vector<unsigned int> members(n);
+  {
+    std::vector<unsigned int> next(start.begin(), start.end() - 1);
+    for (unsigned int i = 0; i < n; i++) {
+      members[next[bucketOf(hashes[i])]++] = i;
+    }
+  }
+
+  // Buckets in order of decreasing size
+  std::vector<unsigned int> bySize(maxBucket + 2, 0);
+  for (unsigned int b = 0; b < m_nBuckets; b++) {
+    bySize[maxBucket - (start[b + 1] - start[b]) + 1]++;
+  }
+  for (unsigned int s = 0; s <= maxBucket; s++) bySize[s + 1] += bySize[s];
+  std::vector<unsigned int> order(m_nBuckets);
+  for (unsigned int b = 0; b < m_nBuckets; b++) {
+    order[bySize[maxBucket - (start[b + 1] - start[b])]++] = b;
+  }
+
+  m_keys.assign(n, noKey);
+  m_displace.assign(m_nBuckets, 0);
+  std::vector<char> taken(n, 0);
+  std::vector<unsigned int> slots(maxBucket);
+  const uint64 maxTries = 16 * (uint64) n + 1024;
+  for (unsigned int k = 0; k < m_nBuckets; k++) {
+    const unsigned int b = order[k];
+    const unsigned int first = start[b];
+    const unsigned int count = start[b + 1] - first;
+    if (count == 0) break;
+
+    uint64 tries = 0;
+    for (;; tries++) {
+      if (tries == maxTries) return false;
+      const uint64 displace = VolumeIdentifierHash::mix(tries + 1);
+      unsigned int placed = 0;
+      for (; placed < count; placed++) {
+        unsigned int slot =
+          slotFor(hashes[members[first + placed]], displace, n);
+        if (taken[slot]) break;
+        taken[slot] = 1;
+        slots[placed] = slot;
+      }
+      if (placed == count) {
+        m_displace[b] = displace;
+        break;
+      }
+      for (unsigned int j = 0; j < placed; j++) taken[slots[j]] = 0;
+    }
+    for (unsigned int j = 0; j < count; j++) {
+      m_keys[slots[j]] = keys[members[first + j]];
+    }
+  }
+  return true;
+}
@@ -0,0 +1,72 @@
+// File and Version Information:
+//      \$Header\$
+//
+// Description:
+//      The text scanner shared by VolumeIdentifier::parse() and
+//      WideVolumeIdentifier::parse().  Not installed; for use by idents
+//      sources only.
+
+#ifndef idents_VolumeIdParse_h
+#define idents_VolumeIdParse_h
+
+#include "idents/VolumeIdentifier.h"
+#include <cassert>
+#include <cstring>
+
+namespace idents {
+namespace scan {
+
+  /// Scan @a len characters of @a text, in the form written by
+  /// VolumeIdentifier::name(), calling @a target.append(field) for
+  /// each of at most @a maxFields fields.  Returns the Status parse()
+  /// gives; on failure some fields may have been appended already.
+  template <class Target>
+  VolumeIdentifier::Status fields(const char* text, std::size_t len,
+                                  const char* delimiter, unsigned maxFields,
+                                  Target& target)
+  {
+    const std::size_t delimLen = std::strlen(delimiter);
+    assert(delimLen > 0);
+    const unsigned maxField = VolumeIdentifier::maxFieldValue();
+    const char* p = text;
+    const char* end = text + len;
+
+    if ((delimLen <= len) && (std::memcmp(p, delimiter, delimLen) == 0)) {
+      p += delimLen;
+    }
+
+    unsigned size = 0;
+    while (p != end) {
+      // Digits are accumulated without range check until the field
+      // ends; saturate so long runs of digits can't overflow
+      const char* fieldStart = p;
+      unsigned field = 0;
+      while ((p != end) && (*p >= '0') && (*p <= '9')) {
+        if (field <= maxField) field = 10 * field + (*p - '0');
+        ++p;
+      }
+      if (p == fieldStart) {
+        if ((std::size_t(end - p) >= delimLen) && 
+            (std::memcmp(p, delimiter, delimLen) == 0)) {
+          return VolumeIdentifier::eEmptyField;
+        }
+        return VolumeIdentifier::eBadCharacter;
+      }
+      if (size >= maxFields) return VolumeIdentifier::eTooManyFields;
+      if (field > maxField) return VolumeIdentifier::eFieldTooLarge;
+      target.append(field);
+      size++;
+
+      if (p == end) break;
+      if ((std::size_t(end - p) < delimLen) || 
+          (std::memcmp(p, delimiter, delimLen) != 0)) {
+        return VolumeIdentifier::eBadCharacter;
+      }
+      p += delimLen;
+    }
+    return VolumeIdentifier::eOk;
+  }
+
+}
+}
+#endif
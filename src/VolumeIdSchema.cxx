@@ -0,0 +1,297 @@
+// File and Version Information:
+//      \$Header\$
+//
+// Description:
+//      Description of the VolumeIdentifier fields read by the id
+//      classes, loaded from a text file and compiled into a table of
+//      shifts.
+
+#include "idents/VolumeIdSchema.h"
+#include "facilities/Util.h"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
+
+using namespace idents;
+
+namespace {
+  const char* const fieldNames[VolumeIdSchema::eNumFields] = {
+    "LATObjects", "TowerY", "TowerX", "TowerObjects",
+    "TkrTray", "TkrMeasure", "TkrBotTop", "TkrLadder", "TkrWafer",
+    "CalLayer", "CalMeasure", "CalLog", "CalCellCmp",
+    "AcdFace", "AcdType", "AcdRow", "AcdColumn", "AcdBent",
+    "AcdRibbonOrient", "AcdRibbonNum"
+  };
+
+  const char* const valueNames[VolumeIdSchema::eNumValues] = {
+    "LATTowers", "LATACD", "TowerCAL", "TowerTKR", "AcdTile", "AcdRibbon"
+  };
+
+  const char* const subsystemNames[VolumeIdentifier::eNumSubsystems] = {
+    "", "Tkr", "Cal", "Acd"
+  };
+
+  void fail(const std::string& source, unsigned line,
+            const std::string& what) {
+    std::ostringstream msg;
+    msg << "VolumeIdSchema: " << source;
+    if (line) msg << " line " << line;
+    msg << ": " << what;
+    throw std::invalid_argument(msg.str());
+  }
+}
+
+/* Layout of the xmlGeoDbs geometries (see
+http://www.slac.stanford.edu/exp/glast/ground/software/geometry/docs/identifiers/geoId-RitzId.shtml)
+   towers:  fLATObjects/fTowerY/fTowerX/fTowerObjects/...
+   TKR:     .../fTray/fMeasure/fBotTop/fLadder/fWafer
+   CAL:     .../fLayer/fMeasure/fCALLog/fCellCmp
+   ACD:     fLATObjects/fFace/40/fRow/fColumn/fBent           (tile)
+            fLATObjects/fFace/41/6-fOrientation/fRibbonNum   (ribbon)
+*/
+const VolumeIdSchema::Tables VolumeIdSchema::s_builtin = {
+  // index
+  {0, 1, 2, 3,
+   4, 5, 6, 7, 8,
+   4, 5, 6, 7,
+   1, 2, 3, 4, 5,
+   3, 4},
+  // shift
+  {54, 48, 42, 36,
+   30, 24, 18, 12, 6,
+   30, 24, 18, 12,
+   48, 42, 36, 30, 24,
+   36, 30},
+  // value
+  {0, 1, 0, 1, 40, 41},
+  // compact layouts: levels, widths, shifts
+  {{0, {0}, {0}},                                        // other
+   {9, {1, 2, 2, 1, 5, 1, 1, 2, 2},                     // tkr
+       {31, 29, 27, 26, 21, 20, 19, 17, 15}},
+   {9, {1, 2, 2, 1, 3, 1, 4, 3, 4},                     // cal
+       {31, 29, 27, 26, 23, 22, 18, 15, 11}},
+   {7, {1, 3, 6, 4, 4, 3, 3},                           // acd
+       {31, 28, 22, 18, 14, 11, 8}}},
+  // subsystem masks
+  {VolumeIdentifier::s_towerSelect, VolumeIdentifier::s_tkrPattern,
+   VolumeIdentifier::s_calPattern, VolumeIdentifier::s_acdSelect,
+   VolumeIdentifier::s_acdPattern, VolumeIdentifier::fTowerObj,
+   VolumeIdentifier::fLATObj}
+};
+
+VolumeIdSchema::Tables VolumeIdSchema::s_installed;
+
+const VolumeIdSchema::Tables* VolumeIdSchema::s_active =
+  &VolumeIdSchema::s_builtin;
+
+VolumeIdSchema::VolumeIdSchema() : m_tables(s_builtin) {}
+
+VolumeIdSchema::VolumeIdSchema(const std::string& fileName)
+  : m_tables(s_builtin)
+{
+  std::string path(fileName);
+  facilities::Util::expandEnvVar(&path);
+  std::ifstream in(path.c_str());
+  if (!in) fail(path, 0, "cannot open");
+  read(in, path);
+}
+
+const char* VolumeIdSchema::name(Field f)
+{
+  return ((unsigned) f < eNumFields) ? fieldNames[f] : "";
+}
+
+const char* VolumeIdSchema::name(Value v)
+{
+  return ((unsigned) v < eNumValues) ? valueNames[v] : "";
+}
+
+void VolumeIdSchema::read(std::istream& in, const std::string& source)
+{
+  std::string line;
+  unsigned lineNo = 0;
+  while (std::getline(in, line)) {
+    lineNo++;
+    std::string::size_type comment = line.find('#');
+    if (comment != std::string::npos) line.erase(comment);
+
+    std::istringstream words(line);
+    std::string keyword, entry;
+    if (!(words >> keyword)) continue;          // blank line
+    if (!(words >> entry)) fail(source, lineNo, "expected a name");
+    std::vector<int> numbers;
+    int number;
+    while (words >> number) numbers.push_back(number);
+    if (!words.eof()) {
+      words.clear();
+      std::string extra;
+      words >> extra;
+      fail(source, lineNo, "unexpected '" + extra + "'");
+    }
+    if (numbers.empty()) fail(source, lineNo, "expected a number");
+    number = numbers[0];
+
+    if (keyword == "widths") {
+      unsigned s = 1;
+      while ((s < VolumeIdentifier::eNumSubsystems) &&
+             (entry != subsystemNames[s])) s++;
+      if (s == VolumeIdentifier::eNumSubsystems) {
+        fail(source, lineNo, "unknown subsystem " + entry);
+      }
+      if (numbers.size() > VolumeIdentifier::maxSize()) {
+        fail(source, lineNo, "too many widths");
+      }
+      CompactLayout& layout = m_tables.compact[s];
+      layout.levels = numbers.size();
+      for (unsigned i = 0; i < VolumeIdentifier::maxSize(); i++) {
+        int width = (i < numbers.size()) ? numbers[i] : 0;
+        if ((i < numbers.size()) && 
+            ((width < 1) || (width > (int) VolumeIdentifier::s_bitsPer))) {
+          fail(source, lineNo, "width out of range");
+        }
+        layout.width[i] = width;
+      }
+      continue;
+    }
+    if (numbers.size() > 1) fail(source, lineNo, "expected one number");
+
+    if (keyword == "field") {
+      unsigned f = 0;
+      while ((f < eNumFields) && (entry != fieldNames[f])) f++;
+      if (f == eNumFields) fail(source, lineNo, "unknown field " + entry);
+      if ((number < 0) || (number >= (int) VolumeIdentifier::maxSize())) {
+        fail(source, lineNo, "field index out of range");
+      }
+      m_tables.index[f] = number;
+    } else if (keyword == "value") {
+      unsigned v = 0;
+      while ((v < eNumValues) && (entry != valueNames[v])) v++;
+      if (v == eNumValues) fail(source, lineNo, "unknown value " + entry);
+      if ((number < 0) ||
+          (number > (int) VolumeIdentifier::maxFieldValue())) {
+        fail(source, lineNo, "value out of range");
+      }
+      m_tables.value[v] = number;
+    } else {
+      fail(source, lineNo, "unknown keyword " + keyword);
+    }
+  }
+  if (in.bad()) fail(source, 0, "read error");
+  compile(source);
+}
+
+void VolumeIdSchema::compile(const std::string& source)
+{
+  for (unsigned f = 0; f < eNumFields; f++) {
+    m_tables.shift[f] = VolumeIdentifier::fieldShift(m_tables.index[f]);
+  }
+
+  // Fields read from the same kind of volume must not overlap
+  static const Field tkr[] = {fLATObjects, fTowerY, fTowerX, fTowerObjects,
+                              fTkrTray, fTkrMeasure, fTkrBotTop,
+                              fTkrLadder, fTkrWafer};
+  static const Field cal[] = {fLATObjects, fTowerY, fTowerX, fTowerObjects,
+                              fCalLayer, fCalMeasure, fCalLog, fCalCellCmp};
+  static const Field tile[] = {fLATObjects, fAcdFace, fAcdType,
+                               fAcdRow, fAcdColumn, fAcdBent};
+  static const Field ribbon[] = {fLATObjects, fAcdFace, fAcdType,
+                                 fAcdRibbonOrient, fAcdRibbonNum};
+  struct Group {const Field* fields; unsigned n; const char* name;};
+  const Group groups[] = {
+    {tkr, sizeof(tkr) / sizeof(tkr[0]), "tracker"},
+    {cal, sizeof(cal) / sizeof(cal[0]), "calorimeter"},
+    {tile, sizeof(tile) / sizeof(tile[0]), "ACD tile"},
+    {ribbon, sizeof(ribbon) / sizeof(ribbon[0]), "ACD ribbon"}
+  };
+  for (unsigned g = 0; g < sizeof(groups) / sizeof(groups[0]); g++) {
+    unsigned used = 0;
+    for (unsigned k = 0; k < groups[g].n; k++) {
+      unsigned bit = 1u << m_tables.index[groups[g].fields[k]];
+      if (used & bit) {
+        fail(source, 0, std::string("two ") + groups[g].name +
+             " fields share index");
+      }
+      used |= bit;
+    }
+  }
+
+  const unsigned* value = m_tables.value;
+  if ((value[eLATTowers] == value[eLATACD]) ||
+      (value[eTowerCAL] == value[eTowerTKR]) ||
+      (value[eAcdTile] == value[eAcdRibbon])) {
+    fail(source, 0, "selector values are not distinct");
+  }
+
+  typedef VolumeIdentifier::int64 int64;
+  const int64 fieldMask = VolumeIdentifier::maxFieldValue();
+  const unsigned latShift = m_tables.shift[fLATObjects];
+  const unsigned towerShift = m_tables.shift[fTowerObjects];
+  VolumeIdentifier::SubsystemSelect& sel = m_tables.select;
+  sel.towerSelect = (fieldMask << latShift) | (fieldMask << towerShift);
+  sel.tkrPattern = ((int64) value[eLATTowers] << latShift) |
+    ((int64) value[eTowerTKR] << towerShift);
+  sel.calPattern = ((int64) value[eLATTowers] << latShift) |
+    ((int64) value[eTowerCAL] << towerShift);
+  sel.acdSelect = fieldMask << latShift;
+  sel.acdPattern = (int64) value[eLATACD] << latShift;
+  sel.acdMinSize = m_tables.index[fLATObjects];
+  sel.towerMinSize = std::max(m_tables.index[fLATObjects],
+                              m_tables.index[fTowerObjects]);
+
+  compileCompact(source);
+}
+
+void VolumeIdSchema::compileCompact(const std::string& source)
+{
+  const unsigned keyBits = 32;
+  for (unsigned s = 1; s < VolumeIdentifier::eNumSubsystems; s++) {
+    CompactLayout& layout = m_tables.compact[s];
+    unsigned used = s_compactSizeBits;
+    for (unsigned i = 0; i < layout.levels; i++) used += layout.width[i];
+    if (used > keyBits) {
+      fail(source, 0, std::string(subsystemNames[s]) + 
+           " widths need more than 32 bits");
+    }
+    unsigned shift = keyBits;
+    for (unsigned i = 0; i < VolumeIdentifier::maxSize(); i++) {
+      shift -= layout.width[i];
+      layout.shift[i] = (i < layout.levels) ? shift : 0;
+    }
+  }
+
+  // Keys of different subsystems sort like the identifiers only if the
+  // fields which tell the subsystems apart, and those before them, are
+  // placed alike
+  const CompactLayout& tkr = m_tables.compact[VolumeIdentifier::eTkr];
+  const CompactLayout& cal = m_tables.compact[VolumeIdentifier::eCal];
+  const CompactLayout& acd = m_tables.compact[VolumeIdentifier::eAcd];
+  const unsigned lat = m_tables.index[fLATObjects];
+  const unsigned tower = std::max(lat, m_tables.index[fTowerObjects]);
+  if ((tkr.levels <= tower) || (cal.levels <= tower) || 
+      (acd.levels <= lat)) {
+    fail(source, 0, "compact widths do not cover subsystem fields");
+  }
+  for (unsigned i = 0; i <= tower; i++) {
+    if ((tkr.width[i] != cal.width[i]) || 
+        ((i <= lat) && (tkr.width[i] != acd.width[i]))) {
+      fail(source, 0, "compact widths of shared fields differ");
+    }
+  }
+
+  const unsigned* value = m_tables.value;
+  const unsigned towerObjects = m_tables.index[fTowerObjects];
+  if ((value[eLATTowers] >> tkr.width[lat]) || 
+      (value[eLATACD] >> acd.width[lat]) ||
+      (value[eTowerTKR] >> tkr.width[towerObjects]) ||
+      (value[eTowerCAL] >> cal.width[towerObjects])) {
+    fail(source, 0, "selector values do not fit compact widths");
+  }
+}
+
+void VolumeIdSchema::install() const
+{
+  s_installed = m_tables;
+  s_active = &s_installed;
+}
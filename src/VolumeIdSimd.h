@@ -0,0 +1,90 @@
+// File and Version Information:
+//      \$Header\$
+//
+// Description:
+//      Helpers shared by the SIMD batch kernels operating on arrays of
+//      VolumeIdentifier.  Not installed; for use by idents sources only.
+//      The kernels read the in-memory layout of VolumeIdentifier
+//      directly (64-bit value then size, 16 bytes in all); callers
+//      must check simd::layoutOk() and use portable code otherwise.
+//
+//      On x86-64 the kernels are always compiled, each function marked
+//      with IDENTS_TARGET_AVX2 or IDENTS_TARGET_AVX512 so the compiler
+//      may use those instructions there whatever the build flags; they
+//      are called only when SimdLevel::current() allows.
+
+#ifndef idents_VolumeIdSimd_h
+#define idents_VolumeIdSimd_h
+
+#include "idents/VolumeIdentifier.h"
+#include "idents/SimdLevel.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define IDENTS_SIMD_KERNELS
+#define IDENTS_TARGET_AVX2 __attribute__((target("avx2")))
+#define IDENTS_TARGET_AVX512 __attribute__((target("avx512f")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define IDENTS_SIMD_KERNELS
+#define IDENTS_TARGET_AVX2
+#define IDENTS_TARGET_AVX512
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace idents {
+namespace simd {
+
+  /// true if VolumeIdentifier has the layout the kernels assume
+  inline bool layoutOk() { return sizeof(VolumeIdentifier) == 16; }
+
+  /// Use the AVX2 kernels?
+  inline bool avx2() {return SimdLevel::current() >= SimdLevel::eAvx2;}
+
+  /// Use the AVX-512 kernels?
+  inline bool avx512() {return SimdLevel::current() >= SimdLevel::eAvx512;}
+
+#ifdef IDENTS_SIMD_KERNELS
+  /// Load 4 identifiers; values and sizes end up in 64-bit lanes in order
+  IDENTS_TARGET_AVX2
+  inline void load4(const VolumeIdentifier* p, __m256i& values, 
+                    __m256i& sizes) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 2));
+    // unpack gives lanes in order 0, 2, 1, 3
+    values = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), 0xD8);
+    sizes = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b), 0xD8);
+    // upper half of the size word is padding
+    sizes = _mm256_and_si256(sizes, _mm256_set1_epi64x(0xffffffff));
+  }
+
+  /// Low byte of each 64-bit lane packed into 4 consecutive bytes
+  IDENTS_TARGET_AVX2
+  inline int lowBytes4(__m256i v) {
+    const __m256i shuffle = 
+      _mm256_setr_epi8(0, 8, -1, -1, -1, -1, -1, -1,
+                       -1, -1, -1, -1, -1, -1, -1, -1,
+                       -1, -1, 0, 8, -1, -1, -1, -1,
+                       -1, -1, -1, -1, -1, -1, -1, -1);
+    __m256i t = _mm256_shuffle_epi8(v, shuffle);
+    return _mm_cvtsi128_si32(_mm_or_si128(_mm256_castsi256_si128(t),
+                                          _mm256_extracti128_si256(t, 1)));
+  }
+
+  /// Load 8 identifiers; values and sizes end up in 64-bit lanes in order
+  IDENTS_TARGET_AVX512
+  inline void load8(const VolumeIdentifier* p, __m512i& values,
+                    __m512i& sizes) {
+    __m512i a = _mm512_loadu_si512(p);
+    __m512i b = _mm512_loadu_si512(p + 4);
+    values = _mm512_permutex2var_epi64
+      (a, _mm512_setr_epi64(0, 2, 4, 6, 8, 10, 12, 14), b);
+    sizes = _mm512_permutex2var_epi64
+      (a, _mm512_setr_epi64(1, 3, 5, 7, 9, 11, 13, 15), b);
+    sizes = _mm512_and_si512(sizes, _mm512_set1_epi64(0xffffffff));
+  }
+#endif
+
+}
+}
+#endif
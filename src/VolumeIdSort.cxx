@@ -0,0 +1,131 @@
+// File and Version Information:
+//      \$Header\$
+//
+// Description:
+//      LSD radix sort on packed VolumeIdentifier keys.  Each pass builds
+//      a histogram of one key byte per chunk of the input, turns the
+//      histograms into output offsets and scatters; with OpenMP each
+//      chunk is handled by its own thread.  Chunks are scattered in
+//      input order, so the sort is stable.
+
+#include "idents/VolumeIdSort.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace idents {
+
+namespace {
+  typedef VolumeIdentifier::uint64 uint64;
+
+  /// Below this size threading costs more than it saves
+  const std::size_t s_parallelThreshold = 1 << 16;
+
+  const unsigned s_radix = 256;
+}
+
+void detail::radixSortKeys(uint64* keys, unsigned* index, std::size_t n)
+{
+    int nChunks = 1;
+#ifdef _OPENMP
+    if (n >= s_parallelThreshold) nChunks = omp_get_max_threads();
+#endif
+
+    std::vector<uint64> keyBuf(n);
+    std::vector<unsigned> indexBuf(index ? n : 0);
+    uint64* keySrc = keys;
+    uint64* keyDst = &keyBuf[0];
+    unsigned* indexSrc = index;
+    unsigned* indexDst = index ? &indexBuf[0] : 0;
+
+    // counts[c * s_radix + d]: keys in chunk c with digit d, then the
+    // output position of the next such key
+    std::vector<std::size_t> counts(nChunks * s_radix);
+
+    for (unsigned shift = 0; shift < 64; shift += 8) {
+        std::fill(counts.begin(), counts.end(), 0);
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nChunks) schedule(static, 1)
+#endif
+        for (int c = 0; c < nChunks; c++) {
+            std::size_t* count = &counts[c * s_radix];
+            std::size_t end = n * (c + 1) / nChunks;
+            for (std::size_t i = n * c / nChunks; i < end; i++) {
+                count[(keySrc[i] >> shift) & 0xff]++;
+            }
+        }
+
+        // Skip the pass if all keys have the same digit
+        bool trivial = false;
+        std::size_t position = 0;
+        for (unsigned d = 0; d < s_radix; d++) {
+            std::size_t total = 0;
+            for (int c = 0; c < nChunks; c++) total += counts[c*s_radix + d];
+            if (total == n) {
+                trivial = true;
+                break;
+            }
+            for (int c = 0; c < nChunks; c++) {
+                std::size_t count = counts[c * s_radix + d];
+                counts[c * s_radix + d] = position;
+                position += count;
+            }
+        }
+        if (trivial) continue;
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nChunks) schedule(static, 1)
+#endif
+        for (int c = 0; c < nChunks; c++) {
+            std::size_t* next = &counts[c * s_radix];
+            std::size_t end = n * (c + 1) / nChunks;
+            for (std::size_t i = n * c / nChunks; i < end; i++) {
+                std::size_t pos = next[(keySrc[i] >> shift) & 0xff]++;
+                keyDst[pos] = keySrc[i];
+                if (indexSrc) indexDst[pos] = indexSrc[i];
+            }
+        }
+        std::swap(keySrc, keyDst);
+        std::swap(indexSrc, indexDst);
+    }
+
+    if (keySrc != keys) {
+        std::copy(keySrc, keySrc + n, keys);
+        if (index) std::copy(indexSrc, indexSrc + n, index);
+    }
+}
+
+void radixSort(std::vector<VolumeIdentifier>& ids)
+{
+    const std::size_t n = ids.size();
+    // Equal keys are identical identifiers, so stability is moot
+    if (n < 256) {
+        std::sort(ids.begin(), ids.end());
+        return;
+    }
+    std::vector<uint64> keys(n);
+    for (std::size_t i = 0; i < n; i++) keys[i] = ids[i].packedKey();
+    detail::radixSortKeys(&keys[0], 0, n);
+    for (std::size_t i = 0; i < n; i++) {
+        ids[i] = VolumeIdentifier::fromPackedKey(keys[i]);
+    }
+}
+
+void radixSort(std::vector<PackedVolumeId>& ids)
+{
+    const std::size_t n = ids.size();
+    if (n < 256) {
+        std::sort(ids.begin(), ids.end());
+        return;
+    }
+    std::vector<uint64> keys(n);
+    for (std::size_t i = 0; i < n; i++) keys[i] = ids[i].packedKey();
+    detail::radixSortKeys(&keys[0], 0, n);
+    for (std::size_t i = 0; i < n; i++) {
+        ids[i] = PackedVolumeId::fromPackedKey(keys[i]);
+    }
+}
+
+}
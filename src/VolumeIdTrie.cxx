@@ -0,0 +1,167 @@
+// File and Version Information:
+//      \$Header\$
+//
+// Description:
+//      Prefix tree over VolumeIdentifiers.  Fields are taken most 
+//      significant first from the packed value, so descending the tree
+//      is a shift, a mask and a popcount per level.
+
+#include "idents/VolumeIdTrie.h"
+#include "idents/BitOps.h"
+#include <algorithm>
+
+using namespace idents;
+
+namespace {
+  inline unsigned fieldOf(VolumeIdentifier::int64 value, unsigned depth) {
+    return (value >> VolumeIdentifier::fieldShift(depth)) &
+      VolumeIdentifier::maxFieldValue();
+  }
+
+  /// Number of leading fields @a a and @a b share
+  inline int commonFields(const VolumeIdentifier& a,
+                          const VolumeIdentifier& b) {
+    const int shorter = std::min(a.size(), b.size());
+    int common = 0;
+    while ((common < shorter) && (a[common] == b[common])) common++;
+    return common;
+  }
+}
+
+void VolumeIdTrie::clear()
+{
+    m_nodes.clear();
+    m_nodes.push_back(Node());
+}
+
+bool VolumeIdTrie::insert(const VolumeIdentifier& id)
+{
+    if (contains(id)) return false;
+    insertNew(id);
+    return true;
+}
+
+void VolumeIdTrie::insertNew(const VolumeIdentifier& id)
+{
+    const int64 value = id.getValue();
+    unsigned node = 0;
+    m_nodes[0].count++;
+    for (int depth = 0; depth < id.size(); depth++) {
+        uint64 bit = 1ULL << fieldOf(value, depth);
+        unsigned rank = bitops::popcount64(m_nodes[node].childMask & (bit-1));
+        if ((m_nodes[node].childMask & bit) == 0) {
+            // Move the children to the end, with room for the new one
+            const unsigned first = m_nodes[node].firstChild;
+            const unsigned nChildren = 
+                bitops::popcount64(m_nodes[node].childMask);
+            const unsigned moved = m_nodes.size();
+            m_nodes.resize(moved + nChildren + 1);
+            std::copy(m_nodes.begin() + first, 
+                      m_nodes.begin() + first + rank,
+                      m_nodes.begin() + moved);
+            std::copy(m_nodes.begin() + first + rank, 
+                      m_nodes.begin() + first + nChildren,
+                      m_nodes.begin() + moved + rank + 1);
+            m_nodes[node].firstChild = moved;
+            m_nodes[node].childMask |= bit;
+        }
+        node = m_nodes[node].firstChild + rank;
+        m_nodes[node].count++;
+    }
+    m_nodes[node].terminal = true;
+}
+
+void VolumeIdTrie::build(const VolumeIdentifier* sorted, std::size_t n)
+{
+    // Nodes are laid out level by level, each level in sorted order,
+    // so the children of a node, which are added in ascending field,
+    // follow one another and the groups of children follow the order
+    // of their parents.  Each identifier adds one node per field
+    // beyond the prefix it shares with its predecessor; next[d] starts
+    // as the index of the first node of depth d.
+    const unsigned maxDepth = VolumeIdentifier::maxSize();
+    std::vector<std::size_t> next(maxDepth + 2, 0);
+    for (std::size_t i = 0; i < n; i++) {
+        const int common = (i > 0) ? commonFields(sorted[i], sorted[i-1]) : 0;
+        for (int depth = common; depth < sorted[i].size(); depth++) {
+            next[depth + 2]++;
+        }
+    }
+    next[1] = 1;
+    for (unsigned depth = 2; depth <= maxDepth + 1; depth++) {
+        next[depth] += next[depth - 1];
+    }
+    m_nodes.assign(next[maxDepth + 1], Node());
+
+    // One pass over the identifiers; path[d] is the node of the first
+    // d fields of the previous one
+    std::vector<unsigned> path(maxDepth + 1, 0);
+    for (std::size_t i = 0; i < n; i++) {
+        if ((i > 0) && (sorted[i] == sorted[i-1])) continue;
+        const int size = sorted[i].size();
+        const int common = (i > 0) ? commonFields(sorted[i], sorted[i-1]) : 0;
+        for (int depth = common; depth < size; depth++) {
+            const unsigned child = next[depth + 1]++;
+            Node& parent = m_nodes[path[depth]];
+            if (parent.childMask == 0) parent.firstChild = child;
+            parent.childMask |= 1ULL << sorted[i][depth];
+            path[depth + 1] = child;
+        }
+        for (int depth = 0; depth <= size; depth++) {
+            m_nodes[path[depth]].count++;
+        }
+        m_nodes[path[size]].terminal = true;
+    }
+}
+
+int VolumeIdTrie::findNode(const VolumeIdentifier& prefix) const
+{
+    const int64 value = prefix.getValue();
+    unsigned node = 0;
+    for (int depth = 0; depth < prefix.size(); depth++) {
+        uint64 bit = 1ULL << fieldOf(value, depth);
+        const Node& n = m_nodes[node];
+        if ((n.childMask & bit) == 0) return -1;
+        node = n.firstChild + bitops::popcount64(n.childMask & (bit - 1));
+    }
+    return node;
+}
+
+bool VolumeIdTrie::contains(const VolumeIdentifier& id) const
+{
+    int node = findNode(id);
+    return (node >= 0) && m_nodes[node].terminal;
+}
+
+std::size_t VolumeIdTrie::count(const VolumeIdentifier& prefix) const
+{
+    int node = findNode(prefix);
+    return (node >= 0) ? m_nodes[node].count : 0;
+}
+
+void VolumeIdTrie::subtree(const VolumeIdentifier& prefix,
+                           std::vector<VolumeIdentifier>& out) const
+{
+    int node = findNode(prefix);
+    if (node < 0) return;
+    out.reserve(out.size() + m_nodes[node].count);
+    collect(node, prefix.getValue(), prefix.size(), out);
+}
+
+void VolumeIdTrie::collect(unsigned node, int64 value, unsigned depth,
+                           std::vector<VolumeIdentifier>& out) const
+{
+    const Node& n = m_nodes[node];
+    if (n.terminal) {
+        VolumeIdentifier id;
+        id.init(value, depth);
+        out.push_back(id);
+    }
+    uint64 mask = n.childMask;
+    for (unsigned k = 0; mask != 0; k++, mask &= mask - 1) {
+        int64 field = bitops::ctz64(mask);
+        collect(n.firstChild + k, 
+                value | (field << VolumeIdentifier::fieldShift(depth)),
+                depth + 1, out);
+    }
+}
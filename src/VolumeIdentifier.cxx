@@ -16,96 +16,367 @@
 
 
 #include "idents/VolumeIdentifier.h"
+#include "idents/BitFieldLayout.h"
+#include "VolumeIdSimd.h"
+#include "VolumeIdParse.h"
 
-#include <sstream>
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <stdexcept>
 
 using namespace idents;
 
+// Return the equivalent string of the volume identifier, that is the single
+// ids separated by a '/' character
+std::string VolumeIdentifier::name(const char* delimiter) const
+{
+    char buf[64];
+    unsigned len = name(buf, sizeof(buf), delimiter);
+    if (len < sizeof(buf)) return std::string(buf, len);
 
-VolumeIdentifier::VolumeIdentifier():  m_value(0), m_size(0){}
+    // Only reached for unusually long delimiters
+    std::vector<char> big(len + 1);
+    writeName(&big[0], delimiter, std::strlen(delimiter));
+    return std::string(&big[0], len);
+}
 
-void VolumeIdentifier::init(int64 value, unsigned int size)
+unsigned VolumeIdentifier::name(char* buf, unsigned bufSize,
+                                const char* delimiter) const
 {
-    m_value = value;
-    m_size = size;
+    unsigned delimLen = std::strlen(delimiter);
+    unsigned len = nameLength(delimLen);
+    if (len < bufSize) writeName(buf, delimiter, delimLen);
+    return len;
 }
 
-// Return the equivalent string of the volume identifier, that is the single
-// ids separated by a '/' character
-std::string VolumeIdentifier::name(const char* delimiter) const
+unsigned VolumeIdentifier::maxNameLength(const char* delimiter)
+{
+    // every field at most 2 digits
+    unsigned delimLen = std::strlen(delimiter);
+    return delimLen + s_maxSize * (2 + delimLen);
+}
+
+void VolumeIdentifier::names(const VolumeIdentifier* ids, unsigned n,
+                             std::vector<char>& arena,
+                             std::vector<unsigned>& offsets,
+                             const char* delimiter)
+{
+    unsigned delimLen = std::strlen(delimiter);
+
+    // First pass sizes the arena exactly, second pass fills it
+    offsets.resize(n + 1);
+    unsigned total = 0;
+    for (unsigned i = 0; i < n; i++) {
+        offsets[i] = total;
+        total += ids[i].nameLength(delimLen) + 1;
+    }
+    offsets[n] = total;
+
+    arena.resize(total);
+    for (unsigned i = 0; i < n; i++) {
+        ids[i].writeName(&arena[0] + offsets[i], delimiter, delimLen);
+    }
+}
+
+// The name is the delimiter followed by each field and a delimiter, with
+// the final character dropped (this is what name() has always returned).
+unsigned VolumeIdentifier::nameLength(unsigned delimLen) const
+{
+    unsigned len = delimLen;
+    for (int i = 0; i < m_size; i++) {
+        len += (((*this)[i] < 10) ? 1 : 2) + delimLen;
+    }
+    return (len > 0) ? len - 1 : 0;
+}
+
+void VolumeIdentifier::writeName(char* buf, const char* delimiter,
+                                 unsigned delimLen) const
 {
-    std::stringstream s;
-    
-    unsigned int bufIds = 0;
     static unsigned int mask = (1 << s_bitsPer) - 1; //  6 bits for final mask
-   
-    int64 copyValue = m_value;
-    
-    int i;
-    s << delimiter;
+    char* p = buf;
+    std::memcpy(p, delimiter, delimLen);
+    p += delimLen;
 
     // Fields are written out starting with one located in most significant
     // bits.  Since 64 is not evenly divisible by s_bitsPer (6) this field
     // is located in bits 54-59.  Top 4 bits are unused.
-    for (i = 0; i < m_size; i++)
-    {
-        bufIds = ((copyValue ) >> s_maxShift) & mask;
-        s << bufIds << delimiter;
+    uint64 copyValue = (uint64) m_value;
+    for (int i = 0; i < m_size; i++) {
+        unsigned bufIds = (copyValue >> s_maxShift) & mask;
+        if (bufIds >= 10) {
+            *p++ = '0' + bufIds / 10;
+            bufIds %= 10;
+        }
+        *p++ = '0' + bufIds;
+        std::memcpy(p, delimiter, delimLen);
+        p += delimLen;
         copyValue = copyValue << s_bitsPer;
     }
-    
-    std::string tmp=s.str();
-    return tmp.substr(0,tmp.size()-1);
+    if (p != buf) --p;
+    *p = '\0';
 }
 
 
-unsigned int VolumeIdentifier::operator[](unsigned int index)
+namespace {
+  /// Fields from scan::fields(), packed as they arrive
+  struct PackedFields {
+    PackedFields() : value(0), size(0) {}
+    void append(unsigned field) {
+      value |= (VolumeIdentifier::int64) field << 
+        VolumeIdentifier::fieldShift(size++);
+    }
+    VolumeIdentifier::int64 value;
+    unsigned size;
+  };
+}
+
+VolumeIdentifier::Status 
+VolumeIdentifier::parse(const char* text, std::size_t len,
+                        VolumeIdentifier& id, const char* delimiter)
 {
-    static int64 mask2 = (1 << s_bitsPer) - 1;            /* 63 */
-    int64 copyShifted = m_value >> (s_maxShift - s_bitsPer*index);
-    return (copyShifted & mask2);
+    PackedFields fields;
+    Status status = scan::fields(text, len, delimiter, s_maxSize, fields);
+    if (status == eOk) id.init(fields.value, fields.size);
+    return status;
 }
 
-unsigned int VolumeIdentifier::operator[](unsigned int index) const
+VolumeIdentifier::Status
+VolumeIdentifier::parseLines(const char* buf, std::size_t len,
+                             std::vector<VolumeIdentifier>& ids,
+                             const char* delimiter, std::size_t* badLine)
 {
-  static int64 mask2 = (1 << s_bitsPer) -1 ; // 63;
-    int64 copyShifted = m_value >> (s_maxShift - s_bitsPer*index);
-    return (copyShifted & mask2);
+    const char* end = buf + len;
+    ids.reserve(ids.size() + std::count(buf, end, '\n') + 1);
+
+    std::size_t line = 0;
+    for (const char* p = buf; p < end; line++) {
+        const char* eol = 
+            static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (eol == 0) eol = end;
+        const char* next = eol + 1;
+        if ((eol != p) && (eol[-1] == '\r')) --eol;
+
+        if (eol != p) {
+            VolumeIdentifier id;
+            Status status = parse(p, eol - p, id, delimiter);
+            if (status != eOk) {
+                if (badLine) *badLine = line;
+                return status;
+            }
+            ids.push_back(id);
+        }
+        p = next;
+    }
+    return eOk;
 }
 
+namespace {
+  typedef VolumeIdentifier::uint64 uint64;
+
+  /// true if any of the @a n bytes at @a p exceeds maxFieldValue(): 
+  /// bytes are OR-ed together a word at a time and the top two bits
+  /// of each byte tested once
+  inline bool anyTooLarge(const unsigned char* p, std::size_t n) {
+    uint64 bits = 0;
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      uint64 word;
+      std::memcpy(&word, p + i, 8);
+      bits |= word;
+    }
+    for (; i < n; i++) bits |= p[i];
+    return (bits & 0xc0c0c0c0c0c0c0c0ULL) != 0;
+  }
+
+  /// Fields 0-7, listed from the most significant end.  Fields 8 and
+  /// 9 are simple enough to handle directly.
+  BitFieldLayout makeHeadLayout() {
+    unsigned char shifts[8], widths[8];
+    for (unsigned k = 0; k < 8; k++) {
+      shifts[k] = VolumeIdentifier::fieldShift(k);
+      widths[k] = bitops::popcount64(VolumeIdentifier::maxFieldValue());
+    }
+    return BitFieldLayout(8, shifts, widths);
+  }
+
+  const BitFieldLayout& headLayout() {
+    static const BitFieldLayout layout = makeHeadLayout();
+    return layout;
+  }
+
+  /// Value holding the @a n <= 10 fields at @a fields, which must be 
+  /// in range.  If @a wholeWords, 16 bytes may be read from @a fields.
+  inline VolumeIdentifier::int64 packFields(const BitFieldLayout& head,
+                                            const unsigned char* fields,
+                                            unsigned n, bool wholeWords) {
+    uint64 w0, w1;
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    // Whole words with the bytes beyond the row cleared
+    if (wholeWords) {
+      std::memcpy(&w0, fields, 8);
+      std::memcpy(&w1, fields + 8, 8);
+      w0 &= (n >= 8) ? ~0ULL : (1ULL << (8 * n)) - 1;
+      w1 &= (n > 8) ? (1ULL << (8 * (n - 8))) - 1 : 0;
+    } else
+#endif
+    {
+      (void) wholeWords;
+      w0 = BitFieldLayout::load(fields, (n < 8) ? n : 8);
+      w1 = BitFieldLayout::load(fields + 8, (n > 8) ? n - 8 : 0);
+    }
+    return (VolumeIdentifier::int64) 
+      (head.pack(w0) | ((w1 & 0x3f) << 6) | ((w1 >> 8) & 0x3f));
+  }
+}
 
-void VolumeIdentifier::prepend( const VolumeIdentifier& id)
+void VolumeIdentifier::unpack(unsigned char* fields) const
 {
-    m_value = (m_value >> (s_bitsPer*id.size())) | id.getValue();
-    m_size += id.size();
+    headLayout().unpack(m_value, fields);
+    fields[8] = (m_value >> 6) & 0x3f;
+    fields[9] = m_value & 0x3f;
 }
 
-void VolumeIdentifier::append( const VolumeIdentifier& id)
+VolumeIdentifier::Status 
+VolumeIdentifier::build(const unsigned char* fields, unsigned n,
+                        VolumeIdentifier& id)
 {
-    m_value = m_value | (id.getValue() >> (s_bitsPer*m_size));
-    m_size += id.size();
+    if (n > s_maxSize) return eTooManyFields;
+    if (anyTooLarge(fields, n)) return eFieldTooLarge;
+    id.init(packFields(headLayout(), fields, n, false), n);
+    return eOk;
 }
 
-void VolumeIdentifier::append( unsigned int id)
+VolumeIdentifier::Status 
+VolumeIdentifier::build(const unsigned char* fields, std::size_t count,
+                        unsigned depth, VolumeIdentifier* out,
+                        const unsigned char* sizes, std::size_t* badRow)
 {
-  // the first id appended becomes the most significant digit in the internal
-  // rappresentation. In this way I can obtain an equivalent of the lexicographic order
-  // between volume identifiers
-  if (m_size >= (int) s_maxSize) {
-    std::string 
-      errtxt("VolumeIdentifier::append: id is already of maximum size");
-    throw std::range_error(errtxt);
+    // Usually the whole matrix is in range and rows need no checks.
+    // Otherwise (or if rows are only partly used) check row by row
+    // to find the first bad one.
+    const bool allOk = !anyTooLarge(fields, count * depth);
+    const unsigned char* end = fields + count * depth;
+    const BitFieldLayout& head = headLayout();
+    for (std::size_t i = 0; i < count; i++) {
+        const unsigned char* row = fields + i * depth;
+        const unsigned n = sizes ? sizes[i] : depth;
+        Status status = eOk;
+        if ((n > depth) || (n > s_maxSize)) status = eTooManyFields;
+        else if (!allOk && anyTooLarge(row, n)) status = eFieldTooLarge;
+        if (status != eOk) {
+            if (badRow) *badRow = i;
+            return status;
+        }
+        out[i].init(packFields(head, row, n, end - row >= 16), n);
+    }
+    return eOk;
+}
+
+#ifdef IDENTS_SIMD_KERNELS
+namespace {
+  typedef VolumeIdentifier::SubsystemSelect Select;
+
+  /// VolumeIdentifier::classify() for four identifiers
+  IDENTS_TARGET_AVX2
+  inline __m256i classify4(const Select& sel, __m256i values, 
+                           __m256i sizes) {
+    __m256i towerFields = 
+      _mm256_and_si256(values, _mm256_set1_epi64x(sel.towerSelect));
+    __m256i tower = 
+      _mm256_cmpgt_epi64(sizes, _mm256_set1_epi64x(sel.towerMinSize));
+    __m256i tkr = _mm256_and_si256
+      (tower, _mm256_cmpeq_epi64(towerFields, 
+                                 _mm256_set1_epi64x(sel.tkrPattern)));
+    __m256i cal = _mm256_and_si256
+      (tower, _mm256_cmpeq_epi64(towerFields, 
+                                 _mm256_set1_epi64x(sel.calPattern)));
+    __m256i acd = _mm256_and_si256
+      (_mm256_cmpgt_epi64(sizes, _mm256_set1_epi64x(sel.acdMinSize)),
+       _mm256_cmpeq_epi64(_mm256_and_si256
+                          (values, _mm256_set1_epi64x(sel.acdSelect)),
+                          _mm256_set1_epi64x(sel.acdPattern)));
+    return _mm256_or_si256
+      (_mm256_or_si256
+       (_mm256_and_si256(tkr, _mm256_set1_epi64x(VolumeIdentifier::eTkr)),
+        _mm256_and_si256(cal, _mm256_set1_epi64x(VolumeIdentifier::eCal))),
+       _mm256_and_si256(acd, _mm256_set1_epi64x(VolumeIdentifier::eAcd)));
   }
-  else if (id > s_maxFieldValue) {
-    std::string 
-      errtxt("VolumeIdentifier::append: new field value is too large");
-    throw std::range_error(errtxt);
+
+  /// Subsystem counts of ids[0..], 4 at a time, added to @a counts;
+  /// returns the number counted
+  IDENTS_TARGET_AVX2
+  std::size_t countAvx2(const VolumeIdentifier* ids, std::size_t n,
+                        Select sel, std::size_t counts[])
+  {
+    const unsigned nSub = VolumeIdentifier::eNumSubsystems;
+    // per-lane counts; a matching compare gives -1
+    __m256i lanes[VolumeIdentifier::eNumSubsystems];
+    for (unsigned s = 0; s < nSub; s++) lanes[s] = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      __m256i values, sizes;
+      simd::load4(ids + i, values, sizes);
+      __m256i codes = classify4(sel, values, sizes);
+      for (unsigned s = 0; s < nSub; s++) {
+        lanes[s] = _mm256_sub_epi64
+          (lanes[s], _mm256_cmpeq_epi64(codes, _mm256_set1_epi64x(s)));
+      }
+    }
+    for (unsigned s = 0; s < nSub; s++) {
+      VolumeIdentifier::int64 lane[4];
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(lane), lanes[s]);
+      counts[s] += lane[0] + lane[1] + lane[2] + lane[3];
+    }
+    return i;
+  }
+
+  /// Copies ids[0..], 4 at a time, to the subsystem outputs @a out;
+  /// returns the number copied
+  IDENTS_TARGET_AVX2
+  std::size_t partitionAvx2(const VolumeIdentifier* ids, std::size_t n,
+                            Select sel, VolumeIdentifier* out[])
+  {
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      __m256i values, sizes;
+      simd::load4(ids + i, values, sizes);
+      int codes = simd::lowBytes4(classify4(sel, values, sizes));
+      for (unsigned k = 0; k < 4; k++, codes >>= 8) {
+        *out[codes & 0xff]++ = ids[i + k];
+      }
+    }
+    return i;
   }
-  int64 t = id;
-  t &= (1 << s_bitsPer) - 1;    // only use s_bitsPer bits from id.
-  t = t << s_maxShift;
-  m_value = m_value | (t >> s_bitsPer*m_size);
-  m_size++;
+}
+#endif
+
+void VolumeIdentifier::countSubsystems(const VolumeIdentifier* ids,
+                                       std::size_t n,
+                                       std::size_t counts[eNumSubsystems],
+                                       const SubsystemSelect& sel)
+{
+    for (unsigned s = 0; s < eNumSubsystems; s++) counts[s] = 0;
+    std::size_t i = 0;
+
+#ifdef IDENTS_SIMD_KERNELS
+    if (simd::layoutOk() && simd::avx2()) i = countAvx2(ids, n, sel, counts);
+#endif
+
+    for (; i < n; i++) counts[ids[i].classify(sel)]++;
+}
+
+void VolumeIdentifier::partitionSubsystems(const VolumeIdentifier* ids, 
+                                           std::size_t n,
+                                           VolumeIdentifier* 
+                                           out[eNumSubsystems],
+                                           const SubsystemSelect& sel)
+{
+    std::size_t i = 0;
+
+#ifdef IDENTS_SIMD_KERNELS
+    if (simd::layoutOk() && simd::avx2()) i = partitionAvx2(ids, n, sel, out);
+#endif
+
+    for (; i < n; i++) *out[ids[i].classify(sel)]++ = ids[i];
 }
@@ -0,0 +1,74 @@
+// File and Version Information:
+//      \$Header\$
+//
+// Description:
+//      Two-word VolumeIdentifier of up to 20 fields.
+
+#include "idents/WideVolumeIdentifier.h"
+#include "VolumeIdParse.h"
+
+using namespace idents;
+
+const unsigned WideVolumeIdentifier::s_wordSize;
+
+void WideVolumeIdentifier::append(const WideVolumeIdentifier& id)
+{
+    const int size = id.size();
+    if (this->size() + size > (int) maxSize()) {
+        throw std::range_error
+            ("WideVolumeIdentifier::append: result is too long");
+    }
+    for (int i = 0; i < size; i++) append(id[i]);
+}
+
+void WideVolumeIdentifier::prepend(const WideVolumeIdentifier& id)
+{
+    if (size() + id.size() > (int) maxSize()) {
+        throw std::range_error
+            ("WideVolumeIdentifier::prepend: result is too long");
+    }
+    WideVolumeIdentifier result(id);
+    result.append(*this);
+    *this = result;
+}
+
+bool WideVolumeIdentifier::isDescendantOf(const WideVolumeIdentifier& prefix)
+    const
+{
+    const unsigned n = prefix.size();
+    if (size() < (int) n) return false;
+    if (n <= s_wordSize) {
+        return (((m_hi ^ prefix.m_hi) >> 4) &
+                (uint64) VolumeIdentifier::prefixMask(n)) == 0;
+    }
+    return (((m_hi ^ prefix.m_hi) >> 4) == 0) &&
+        ((((m_lo ^ prefix.m_lo) >> 4) &
+          (uint64) VolumeIdentifier::prefixMask(n - s_wordSize)) == 0);
+}
+
+// Same form as VolumeIdentifier::name(): the delimiter followed by each
+// field and a delimiter, with the final character dropped
+std::string WideVolumeIdentifier::name(const char* delimiter) const
+{
+    std::string result(delimiter);
+    const int size = this->size();
+    for (int i = 0; i < size; i++) {
+        unsigned field = (*this)[i];
+        if (field >= 10) result += char('0' + field / 10);
+        result += char('0' + field % 10);
+        result += delimiter;
+    }
+    if (!result.empty()) result.erase(result.size() - 1);
+    return result;
+}
+
+VolumeIdentifier::Status
+WideVolumeIdentifier::parse(const char* text, std::size_t len,
+                            WideVolumeIdentifier& id, const char* delimiter)
+{
+    WideVolumeIdentifier result;
+    VolumeIdentifier::Status status = 
+        scan::fields(text, len, delimiter, maxSize(), result);
+    if (status == VolumeIdentifier::eOk) id = result;
+    return status;
+}
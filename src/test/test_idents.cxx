@@ -5,11 +5,1734 @@
 #include "idents/AcdId.h"
 #include "idents/CalXtalId.h"
 #include "idents/TkrId.h"
+#include "idents/VolumeIdColumns.h"
+#include "idents/SimdLevel.h"
+#include "idents/VolumeIdMap.h"
+#include "idents/VolumeIdTrie.h"
+#include "idents/VolumeIdAlgorithms.h"
+#include "idents/VolumeIdSort.h"
+#include "idents/VolumeIdSchema.h"
+#include "idents/CompactVolumeId.h"
+#include "idents/VolumeIdInternTable.h"
+#include "idents/PackedVolumeId.h"
+#include "idents/WideVolumeIdentifier.h"
+#include "idents/BitFieldLayout.h"
+#include "idents/AcdGapId.h"
+#include "idents/VolumeIdOrderedMap.h"
+#include "idents/VolumeIdAggregator.h"
+#include "idents/VolumeIdRegistry.h"
+#include "idents/TkrIdColumns.h"
+#include "idents/TkrPlaneIndex.h"
+#include "idents/TkrStripId.h"
+#include "idents/NarrowIds.h"
 #include <map>
+#include <sstream>
 #include <vector>
 #include <iostream>
 #include <algorithm>
+#include <iterator>
 #include <stdexcept>
+#include <string>
+#include <cstring>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifndef WIN32
+#include <pthread.h>
+#endif
+
+// Check non-allocating and batch name formatting against name()
+void testNames(const std::vector<idents::VolumeIdentifier>& ids) {
+  const char* delims[] = {"/", "_", ""};
+  for (unsigned d = 0; d < sizeof(delims)/sizeof(delims[0]); d++) {
+    std::vector<char> arena;
+    std::vector<unsigned> offsets;
+    idents::VolumeIdentifier::names(&ids[0], ids.size(), arena, offsets,
+                                    delims[d]);
+    for (unsigned i = 0; i < ids.size(); i++) {
+      std::string expected = ids[i].name(delims[d]);
+      char buf[64];
+      unsigned len = ids[i].name(buf, sizeof(buf), delims[d]);
+      if ((len != expected.size()) || (expected != buf) ||
+          (expected != &arena[offsets[i]]) ||
+          (offsets[i+1] - offsets[i] != len + 1)) {
+        throw std::logic_error("name formatting mismatch for " + expected);
+      }
+      if (ids[i].name(buf, len, delims[d]) != len) {
+        throw std::logic_error("name length wrong for short buffer");
+      }
+    }
+  }
+  std::cout << "Buffer and batch name formatting agree with name()" 
+            << std::endl;
+}
+
+// Parse names back into identifiers, singly and in bulk
+void testParse(const std::vector<idents::VolumeIdentifier>& ids) {
+  using idents::VolumeIdentifier;
+  std::string lines;
+  std::vector<VolumeIdentifier> nonEmpty;
+  for (unsigned i = 0; i < ids.size(); i++) {
+    VolumeIdentifier parsed;
+    if ((VolumeIdentifier::parse(ids[i].name(), parsed) != 
+         VolumeIdentifier::eOk) || !(parsed == ids[i]) ||
+        (VolumeIdentifier::parse(ids[i].name(":"), parsed, ":") != 
+         VolumeIdentifier::eOk) || !(parsed == ids[i])) {
+      throw std::logic_error("parse failed to invert name()");
+    }
+    // empty identifier has an empty name, which parseLines skips
+    if (ids[i].size() == 0) continue;
+    lines += ids[i].name() + ((i % 2) ? "\r\n" : "\n\n");
+    nonEmpty.push_back(ids[i]);
+  }
+  std::vector<VolumeIdentifier> bulk;
+  if ((VolumeIdentifier::parseLines(lines.data(), lines.size(), bulk) 
+       != VolumeIdentifier::eOk) || (bulk != nonEmpty)) {
+    throw std::logic_error("parseLines failed to invert name()");
+  }
+
+  VolumeIdentifier id;
+  if ((VolumeIdentifier::parse("0/1/2", id) != VolumeIdentifier::eOk) ||
+      (id.name() != "/0/1/2") ||
+      (VolumeIdentifier::parse("/1//2", id) != VolumeIdentifier::eEmptyField) ||
+      (VolumeIdentifier::parse("/1/x", id) != VolumeIdentifier::eBadCharacter) ||
+      (VolumeIdentifier::parse("/1/64", id) != VolumeIdentifier::eFieldTooLarge) ||
+      (VolumeIdentifier::parse("/0/0/0/0/0/0/0/0/0/0/0", id) != 
+       VolumeIdentifier::eTooManyFields)) {
+    throw std::logic_error("parse returned unexpected status");
+  }
+  std::string bad("/1/2\n/3/4\n/5/99\n/6\n");
+  std::size_t badLine = 0;
+  bulk.clear();
+  if ((VolumeIdentifier::parseLines(bad.data(), bad.size(), bulk, "/",
+                                    &badLine) 
+       != VolumeIdentifier::eFieldTooLarge) || (badLine != 2) ||
+      (bulk.size() != 2)) {
+    throw std::logic_error("parseLines did not report bad line");
+  }
+  std::cout << "Parsed names back into identifiers" << std::endl;
+}
+
+/// Deterministic pseudo-random numbers for the tests: the linear
+/// congruential generator of the C standard
+class TestRandom {
+public:
+  explicit TestRandom(unsigned seed) : m_state(seed) {}
+
+  /// Next state; its low bits repeat with short periods
+  unsigned next() {
+    m_state = m_state * 1103515245u + 12345u;
+    return m_state;
+  }
+
+  /// Value in [0, n), from the high bits of the next state
+  unsigned below(unsigned n) {return (next() >> 16) % n;}
+
+private:
+  unsigned m_state;
+};
+
+/// Policy for generated identifiers: sizes from minSize to maxSize
+/// and, where the fixture does not fix them, fields below fieldRange
+struct IdShape {
+  IdShape(unsigned lo, unsigned hi, unsigned range) 
+    : minSize(lo), maxSize(hi), fieldRange(range) {}
+
+  /// Size within both this shape and [lowest, highest]
+  unsigned size(TestRandom& random, unsigned lowest, unsigned highest) const {
+    const unsigned lo = std::max(minSize, lowest);
+    const unsigned hi = std::max(lo, std::min(maxSize, highest));
+    return lo + random.below(hi - lo + 1);
+  }
+
+  unsigned minSize;
+  unsigned maxSize;
+  unsigned fieldRange;
+};
+
+/// Any size, any field value
+const IdShape anyShape(0, 10, 64);
+
+// Deterministic pseudo-random identifiers of the sizes and field
+// values of @a shape
+std::vector<idents::VolumeIdentifier> makeIds(unsigned n, 
+                                              const IdShape& shape = anyShape,
+                                              unsigned seed = 12345) {
+  std::vector<idents::VolumeIdentifier> ids(n);
+  TestRandom random(seed);
+  for (unsigned i = 0; i < n; i++) {
+    unsigned size = shape.size(random, 0, idents::VolumeIdentifier::maxSize());
+    for (unsigned f = 0; f < size; f++) {
+      ids[i].append(random.below(shape.fieldRange));
+    }
+  }
+  return ids;
+}
+
+/// The SIMD levels this processor can run, lowest first.  Batch tests
+/// run at each, so the portable code and every kernel are checked.
+std::vector<idents::SimdLevel::Level> simdLevels() {
+  std::vector<idents::SimdLevel::Level> levels;
+  for (int level = idents::SimdLevel::eScalar; 
+       level <= idents::SimdLevel::detected(); level++) {
+    levels.push_back((idents::SimdLevel::Level) level);
+  }
+  return levels;
+}
+
+// Column decoding must agree with operator[] and size()
+void testColumns() {
+  std::vector<idents::VolumeIdentifier> ids = makeIds(1003);
+  idents::VolumeIdColumns columns;
+  const std::vector<idents::SimdLevel::Level> levels = simdLevels();
+  for (unsigned l = 0; l < levels.size(); l++) {
+    idents::SimdLevel::use(levels[l]);
+    columns.decode(ids);
+    for (unsigned i = 0; i < ids.size(); i++) {
+      if (columns.sizes()[i] != ids[i].size()) {
+        throw std::logic_error("VolumeIdColumns size mismatch");
+      }
+      for (unsigned f = 0; f < idents::VolumeIdColumns::nFields; f++) {
+        if (columns.field(f)[i] != ids[i][f]) {
+          throw std::logic_error("VolumeIdColumns field mismatch");
+        }
+      }
+    }
+  }
+  idents::SimdLevel::use(idents::SimdLevel::detected());
+  std::cout << "Decoded " << columns.count() 
+            << " identifiers into columns" << std::endl;
+  columns.decode(0, 0);
+  if ((columns.count() != 0) || columns.field(0) || columns.sizes()) {
+    throw std::logic_error("empty VolumeIdColumns has columns");
+  }
+}
+
+// VolumeIdMap must behave like std::map, apart from ordering
+void testVolumeIdMap() {
+  std::vector<idents::VolumeIdentifier> ids = makeIds(5000);
+  idents::VolumeIdMap<unsigned> flat;
+  std::map<idents::VolumeIdentifier, unsigned> tree;
+  for (unsigned i = 0; i < ids.size(); i++) {
+    if (idents::VolumeIdentifier::fromPackedKey(ids[i].packedKey()) 
+        != ids[i]) {
+      throw std::logic_error("packedKey does not round trip");
+    }
+    bool inserted = flat.insert(ids[i], i).second;
+    if (inserted != tree.insert(std::make_pair(ids[i], i)).second) {
+      throw std::logic_error("VolumeIdMap insert disagrees with std::map");
+    }
+  }
+  for (unsigned i = 0; i < ids.size(); i += 2) {
+    if (flat.erase(ids[i]) != (tree.erase(ids[i]) == 1)) {
+      throw std::logic_error("VolumeIdMap erase disagrees with std::map");
+    }
+  }
+  unsigned visited = 0;
+  const idents::VolumeIdMap<unsigned>& constFlat = flat;
+  for (idents::VolumeIdMap<unsigned>::const_iterator it = constFlat.begin();
+       it != constFlat.end(); ++it, ++visited) {
+    if (tree[it.key()] != it.value()) {
+      throw std::logic_error("VolumeIdMap iteration gave wrong entry");
+    }
+  }
+  for (unsigned i = 0; i < ids.size(); i++) {
+    const unsigned* found = flat.find(ids[i]);
+    std::map<idents::VolumeIdentifier, unsigned>::const_iterator t = 
+      tree.find(ids[i]);
+    if ((found == 0) != (t == tree.end()) || (found && (*found != t->second))) {
+      throw std::logic_error("VolumeIdMap find disagrees with std::map");
+    }
+  }
+  if ((visited != tree.size()) || (flat.size() != tree.size())) {
+    throw std::logic_error("VolumeIdMap has wrong size");
+  }
+  std::size_t capacity = flat.capacity();
+  flat.clear();
+  flat[ids[0]] += 3;
+  if ((flat.capacity() != capacity) || (flat.size() != 1) || 
+      (flat[ids[0]] != 3)) {
+    throw std::logic_error("VolumeIdMap clear did not keep storage");
+  }
+  std::cout << "VolumeIdMap agrees with std::map" << std::endl;
+}
+
+// true if @a id equals @a prefix or starts with its fields
+bool isUnder(const idents::VolumeIdentifier& id, 
+             const idents::VolumeIdentifier& prefix) {
+  if (id.size() < prefix.size()) return false;
+  for (int f = 0; f < prefix.size(); f++) {
+    if (id[f] != prefix[f]) return false;
+  }
+  return true;
+}
+
+/// Few distinct field values, so that subtrees are populated
+const IdShape treeShape(1, 10, 3);
+
+// Sorted identifiers of @a shape
+std::vector<idents::VolumeIdentifier> makeTreeIds(unsigned n, 
+                                                  const IdShape& shape = 
+                                                  treeShape) {
+  std::vector<idents::VolumeIdentifier> ids = makeIds(n, shape, 54321);
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+// Trie queries must agree with a linear scan
+void testTrie() {
+  std::vector<idents::VolumeIdentifier> ids = makeTreeIds(3000);
+  idents::VolumeIdTrie built, inserted, grown;
+  built.build(ids);
+  for (unsigned i = ids.size(); i > 0; i--) inserted.insert(ids[i-1]);
+  // Inserting into a built trie moves children out of its level order
+  std::vector<idents::VolumeIdentifier> half;
+  for (unsigned i = 0; i < ids.size(); i += 2) half.push_back(ids[i]);
+  grown.build(half);
+  for (unsigned i = 1; i < ids.size(); i += 2) grown.insert(ids[i]);
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  if ((built.size() != ids.size()) || (inserted.size() != ids.size()) ||
+      (grown.size() != ids.size())) {
+    throw std::logic_error("VolumeIdTrie has wrong size");
+  }
+
+  std::vector<idents::VolumeIdentifier> prefixes(1);
+  for (unsigned i = 0; i < ids.size(); i += 7) {
+    idents::VolumeIdentifier prefix;
+    for (int f = 0; f < ids[i].size(); f++) {
+      prefix.append(ids[i][f]);
+      prefixes.push_back(prefix);
+    }
+  }
+  prefixes.push_back(idents::VolumeIdentifier::make<5>());
+  for (unsigned p = 0; p < prefixes.size(); p++) {
+    std::vector<idents::VolumeIdentifier> expected, fromBuilt, fromInserted;
+    std::vector<idents::VolumeIdentifier> fromGrown;
+    for (unsigned i = 0; i < ids.size(); i++) {
+      if (isUnder(ids[i], prefixes[p])) expected.push_back(ids[i]);
+    }
+    built.subtree(prefixes[p], fromBuilt);
+    inserted.subtree(prefixes[p], fromInserted);
+    grown.subtree(prefixes[p], fromGrown);
+    if ((fromBuilt != expected) || (fromInserted != expected) ||
+        (fromGrown != expected) ||
+        (built.count(prefixes[p]) != expected.size()) ||
+        (inserted.count(prefixes[p]) != expected.size())) {
+      throw std::logic_error("VolumeIdTrie subtree mismatch");
+    }
+  }
+  std::cout << "VolumeIdTrie agrees with linear scan" << std::endl;
+
+  // Subtrees are contiguous ranges of the sorted identifiers
+  const std::vector<idents::SimdLevel::Level> levels = simdLevels();
+  for (unsigned p = 0; p < prefixes.size(); p++) {
+    std::vector<idents::VolumeIdentifier>::const_iterator 
+      lo = idents::prefixLowerBound(ids.begin(), ids.end(), prefixes[p]),
+      hi = idents::prefixUpperBound(ids.begin(), ids.end(), prefixes[p]);
+    std::vector<idents::VolumeIdentifier> expected, filtered(ids.size());
+    for (unsigned i = 0; i < ids.size(); i++) {
+      if (isUnder(ids[i], prefixes[p]) != ids[i].isDescendantOf(prefixes[p])) {
+        throw std::logic_error("isDescendantOf disagrees with field compare");
+      }
+      if (isUnder(ids[i], prefixes[p])) expected.push_back(ids[i]);
+    }
+    if (std::vector<idents::VolumeIdentifier>(lo, hi) != expected) {
+      throw std::logic_error("prefix range mismatch");
+    }
+    for (unsigned l = 0; l < levels.size(); l++) {
+      idents::SimdLevel::use(levels[l]);
+      filtered.resize(ids.size());
+      filtered.resize(idents::filterDescendants(&ids[0], ids.size(), 
+                                                prefixes[p], &filtered[0]));
+      if (filtered != expected) {
+        throw std::logic_error("filterDescendants mismatch");
+      }
+    }
+  }
+  idents::SimdLevel::use(idents::SimdLevel::detected());
+  std::cout << "Prefix bounds and filter agree with linear scan" 
+            << std::endl;
+}
+
+bool lessId(const std::pair<idents::VolumeIdentifier, unsigned>& a,
+            const std::pair<idents::VolumeIdentifier, unsigned>& b) {
+  return a.first < b.first;
+}
+
+// Radix sort must give the same order as std::sort / std::stable_sort
+void testRadixSort() {
+  const unsigned sizes[] = {100, 5000, 70000};
+#ifdef _OPENMP
+  // Several threads even on one core, so the largest size goes
+  // through the parallel histogram and scatter
+  const int maxThreads = omp_get_max_threads();
+  omp_set_num_threads(4);
+#endif
+  for (unsigned s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
+    std::vector<idents::VolumeIdentifier> ids = makeIds(sizes[s]);
+    std::vector<idents::VolumeIdentifier> expected(ids);
+    std::sort(expected.begin(), expected.end());
+    idents::radixSort(ids);
+    if (ids != expected) {
+      throw std::logic_error("radixSort disagrees with std::sort");
+    }
+
+    // Few distinct values, so stability matters
+    std::vector<idents::VolumeIdentifier> treeIds = makeTreeIds(sizes[s]);
+    std::vector<std::pair<idents::VolumeIdentifier, unsigned> > pairs;
+    for (unsigned i = 0; i < treeIds.size(); i++) {
+      pairs.push_back(std::make_pair(treeIds[(i * 7919) % treeIds.size()], 
+                                     i));
+    }
+    std::vector<std::pair<idents::VolumeIdentifier, unsigned> > 
+      expectedPairs(pairs);
+    std::stable_sort(expectedPairs.begin(), expectedPairs.end(), lessId);
+    idents::radixSort(pairs);
+    if (pairs != expectedPairs) {
+      throw std::logic_error("radixSort of pairs is not a stable sort");
+    }
+  }
+#ifdef _OPENMP
+  omp_set_num_threads(maxThreads);
+#endif
+  std::cout << "radixSort agrees with std::sort and std::stable_sort" 
+            << std::endl;
+}
+
+// Identifiers resembling real Tkr, Cal and Acd volumes, plus others
+// of @a shape
+std::vector<idents::VolumeIdentifier> makeMixedIds(unsigned n,
+                                                   const IdShape& shape = 
+                                                   anyShape) {
+  std::vector<idents::VolumeIdentifier> ids = makeIds(n, shape);
+  for (unsigned i = 0; i < n; i++) {
+    idents::VolumeIdentifier id;
+    switch (i % 5) {
+    case 0: id = idents::VolumeIdentifier::make<0, 1, 2, 1, 5, 0, 1>(); break;
+    case 1: id = idents::VolumeIdentifier::make<0, 3, 0, 0, 4, 1, 9>(); break;
+    case 2: id = idents::VolumeIdentifier::make<1, 2, 40, 1, 3, 0>(); break;
+    case 3: id = idents::VolumeIdentifier::make<0, 1, 2>(); break;
+    default: continue;
+    }
+    ids[i] = id;
+  }
+  return ids;
+}
+
+/// Every depth of the detector volumes
+const IdShape detectorShape(1, 9, 64);
+
+// Tracker, calorimeter and ACD identifiers with realistic field
+// ranges, of the sizes of @a shape which reach the subsystem fields;
+// the subsystems set the field values, not @a shape
+std::vector<idents::VolumeIdentifier> makeDetectorIds(unsigned n,
+                                                      const IdShape& shape = 
+                                                      detectorShape) {
+  std::vector<idents::VolumeIdentifier> ids;
+  TestRandom random(4321);
+  for (unsigned i = 0; i < n; i++) {
+    unsigned f[7];
+    for (unsigned k = 0; k < 7; k++) f[k] = random.below(0x10000);
+    unsigned size;
+    idents::VolumeIdentifier id;
+    switch (i % 3) {
+    case 0:   // tracker
+      {
+        unsigned fields[9] = {0, f[0] % 4, f[1] % 4, 1, f[2] % 19, f[3] % 2,
+                              f[4] % 2, f[5] % 4, f[6] % 4};
+        size = shape.size(random, 4, 9);
+        for (unsigned k = 0; k < size; k++) id.append(fields[k]);
+      }
+      break;
+    case 1:   // calorimeter
+      {
+        unsigned fields[9] = {0, f[0] % 4, f[1] % 4, 0, f[2] % 8, f[3] % 2,
+                              f[4] % 12, f[5] % 5, f[6] % 12};
+        size = shape.size(random, 4, 9);
+        for (unsigned k = 0; k < size; k++) id.append(fields[k]);
+      }
+      break;
+    default:  // ACD tile or ribbon
+      {
+        bool tile = f[0] % 2;
+        unsigned fields[6] = {1, tile ? f[1] % 5 : 5 + f[1] % 2, 
+                              tile ? 40u : 41u, f[2] % 5, f[3] % 5, f[4] % 2};
+        size = shape.size(random, 1, tile ? 6 : 5);
+        for (unsigned k = 0; k < size; k++) id.append(fields[k]);
+      }
+    }
+    ids.push_back(id);
+  }
+  return ids;
+}
+
+// Subsystem classification and partitioning must agree with isXxx()
+void testClassify() {
+  std::vector<idents::VolumeIdentifier> ids = makeMixedIds(1001);
+  std::size_t counts[idents::VolumeIdentifier::eNumSubsystems];
+
+  std::vector<idents::VolumeIdentifier> 
+    expected[idents::VolumeIdentifier::eNumSubsystems];
+  for (unsigned i = 0; i < ids.size(); i++) {
+    idents::VolumeIdentifier::Subsystem s = idents::VolumeIdentifier::eOther;
+    if (ids[i].isTkr()) s = idents::VolumeIdentifier::eTkr;
+    else if (ids[i].isCal()) s = idents::VolumeIdentifier::eCal;
+    else if (ids[i].isAcd()) s = idents::VolumeIdentifier::eAcd;
+    if (ids[i].classify() != s) {
+      throw std::logic_error("classify disagrees with isTkr/isCal/isAcd");
+    }
+    expected[s].push_back(ids[i]);
+  }
+
+  const std::vector<idents::SimdLevel::Level> levels = simdLevels();
+  for (unsigned l = 0; l < levels.size(); l++) {
+    idents::SimdLevel::use(levels[l]);
+    idents::VolumeIdentifier::countSubsystems(&ids[0], ids.size(), counts);
+    std::vector<idents::VolumeIdentifier> 
+      buckets[idents::VolumeIdentifier::eNumSubsystems];
+    idents::VolumeIdentifier* out[idents::VolumeIdentifier::eNumSubsystems];
+    for (unsigned s = 0; s < idents::VolumeIdentifier::eNumSubsystems; s++) {
+      if (counts[s] != expected[s].size()) {
+        throw std::logic_error("countSubsystems gave wrong count");
+      }
+      buckets[s].resize(counts[s]);
+      out[s] = buckets[s].empty() ? 0 : &buckets[s][0];
+    }
+    idents::VolumeIdentifier::partitionSubsystems(&ids[0], ids.size(), out);
+    for (unsigned s = 0; s < idents::VolumeIdentifier::eNumSubsystems; s++) {
+      if (buckets[s] != expected[s]) {
+        throw std::logic_error("partitionSubsystems gave wrong bucket");
+      }
+    }
+  }
+  idents::SimdLevel::use(idents::SimdLevel::detected());
+  std::cout << "Classified identifiers: " << counts[0] << " other, " 
+            << counts[1] << " tkr, " << counts[2] << " cal, " 
+            << counts[3] << " acd" << std::endl;
+}
+
+/// One thread's share of the schema ordering test: decode with the
+/// schema installed before the thread started
+struct SchemaWork {
+  const idents::VolumeIdentifier* tkrVid;
+  const idents::VolumeIdentifier* acdVid;
+  unsigned wrong;
+};
+
+extern "C" void* schemaWork(void* arg) {
+  SchemaWork& work = *static_cast<SchemaWork*>(arg);
+  for (unsigned k = 0; k < 1000; k++) {
+    idents::TkrId tkr(*work.tkrVid);
+    if ((tkr.getLadder() != 1) || (tkr.getWafer() != 2) ||
+        !work.acdVid->isAcd(idents::VolumeIdSchema::select())) {
+      work.wrong++;
+    }
+  }
+  return 0;
+}
+
+// Decoding must follow the installed schema
+void testSchema() {
+  typedef idents::VolumeIdSchema Schema;
+  idents::VolumeIdentifier tkrVid = 
+    idents::VolumeIdentifier::make<0, 1, 2, 1, 5, 0, 1, 2, 1>();
+  idents::TkrId builtin(tkrVid);
+  if ((builtin.getLadder() != 2) || (builtin.getWafer() != 1)) {
+    throw std::logic_error("built-in schema decoded TkrId wrongly");
+  }
+
+  std::istringstream swapped("# ladder and wafer exchanged\n"
+                             "field TkrLadder 8\n"
+                             "field TkrWafer  7\n"
+                             "\n"
+                             "field AcdRow 4\n"
+                             "field AcdColumn 3   # also swapped\n"
+                             "value LATACD 2\n"
+                             "widths Tkr 2 2 2 1 5 1 1 2 2\n"
+                             "widths Cal 2 2 2 1 3 1 4 3 4\n"
+                             "widths Acd 2 3 6 4 4 3 3\n");
+  Schema schema;
+  schema.read(swapped, "test");
+  schema.install();
+  idents::TkrId tkr(tkrVid);
+  if ((tkr.getLadder() != 1) || (tkr.getWafer() != 2) || 
+      (tkr.getTray() != 5)) {
+    throw std::logic_error("installed schema not used by TkrId");
+  }
+
+  idents::AcdId tile(0, 1, 2, 3);
+  idents::VolumeIdentifier acdVid = tile.volId();
+  if ((acdVid[0] != 2) || (acdVid[3] != 3) || (acdVid[4] != 2) || 
+      !acdVid.isAcd(Schema::select()) || !(idents::AcdId(acdVid) == tile)) {
+    throw std::logic_error("installed schema not used by AcdId");
+  }
+  // Without masks the is.. routines keep the built-in layout, and
+  // a schema's masks may be used without installing it
+  if (acdVid.isAcd() || 
+      (schema.subsystemSelect().acdPattern != Schema::select().acdPattern)) {
+    throw std::logic_error("subsystem masks not taken from the schema");
+  }
+  std::vector<idents::VolumeIdentifier> ids = makeMixedIds(257);
+  ids.push_back(acdVid);
+  std::size_t counts[idents::VolumeIdentifier::eNumSubsystems] = {0};
+  idents::VolumeIdentifier::countSubsystems(&ids[0], ids.size(), counts,
+                                            Schema::select());
+  std::size_t acd = 0;
+  for (unsigned i = 0; i < ids.size(); i++) {
+    acd += ids[i].isAcd(Schema::select());
+  }
+  if (counts[idents::VolumeIdentifier::eAcd] != acd) {
+    throw std::logic_error("countSubsystems ignores installed schema");
+  }
+
+  // install() before the threads start: each sees the whole schema
+  const unsigned nThreads = 4;
+  SchemaWork work[nThreads];
+  for (unsigned t = 0; t < nThreads; t++) {
+    SchemaWork w = {&tkrVid, &acdVid, 0};
+    work[t] = w;
+  }
+#ifndef WIN32
+  pthread_t threads[nThreads];
+  for (unsigned t = 0; t < nThreads; t++) {
+    if (pthread_create(&threads[t], 0, schemaWork, &work[t]) != 0) {
+      throw std::runtime_error("could not start schema test thread");
+    }
+  }
+  for (unsigned t = 0; t < nThreads; t++) pthread_join(threads[t], 0);
+#else
+  for (unsigned t = 0; t < nThreads; t++) schemaWork(&work[t]);
+#endif
+  for (unsigned t = 0; t < nThreads; t++) {
+    if (work[t].wrong) {
+      throw std::logic_error("thread did not see the installed schema");
+    }
+  }
+
+  const char* bad[] = {"field Bogus 3", "field TkrTray 2", "value AcdTile 64",
+                       "field TkrTray", "widget TkrTray 4", 
+                       "value TowerTKR 0"};
+  for (unsigned i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+    std::istringstream in(bad[i]);
+    bool caught = false;
+    try {
+      Schema().read(in, "test");
+    } catch (std::invalid_argument&) {
+      caught = true;
+    }
+    if (!caught) {
+      throw std::logic_error(std::string("schema accepted ") + bad[i]);
+    }
+  }
+
+  Schema().install();
+  idents::CalXtalId xtal(5, 3, 7);
+  idents::VolumeIdentifier* calVid = xtal.makeVolumeId();
+  bool calOk = calVid->isCal(Schema::select()) && 
+    (calVid->size() == 8) &&
+    (idents::CalXtalId(*calVid) == xtal);
+  delete calVid;
+  if (!calOk || !idents::TkrId(tkrVid).isEqual(builtin)) {
+    throw std::logic_error("built-in schema not restored");
+  }
+  std::cout << "Schema drives TkrId, CalXtalId, AcdId and classify" 
+            << std::endl;
+}
+
+// Compact ids must convert back losslessly and sort like the originals
+void testCompact() {
+  std::vector<idents::VolumeIdentifier> ids = makeDetectorIds(3000);
+  for (unsigned i = 0; i < ids.size(); i++) {
+    if (ids[i].classify() == idents::VolumeIdentifier::eOther) {
+      ids[i] = idents::VolumeIdentifier::make<1, 0, 40>();
+    }
+  }
+  std::vector<idents::CompactVolumeId> compact;
+  if (idents::CompactVolumeId::compact(ids, compact) != ids.size()) {
+    throw std::logic_error("CompactVolumeId rejected a detector id");
+  }
+  std::vector<idents::VolumeIdentifier> back;
+  idents::CompactVolumeId::expand(compact, back);
+  if (back != ids) {
+    throw std::logic_error("CompactVolumeId did not convert back");
+  }
+  std::sort(ids.begin(), ids.end());
+  std::sort(compact.begin(), compact.end());
+  idents::CompactVolumeId::expand(compact, back);
+  if (back != ids) {
+    throw std::logic_error("CompactVolumeId sorts differently");
+  }
+
+  idents::VolumeIdentifier tooBig = 
+    idents::VolumeIdentifier::make<0, 1, 2, 1, 19, 0, 1, 4>();
+  idents::VolumeIdentifier other = idents::VolumeIdentifier::make<2, 1>();
+  idents::CompactVolumeId c;
+  if (idents::CompactVolumeId::fromVolumeId(tooBig, c) ||
+      idents::CompactVolumeId::fromVolumeId(other, c)) {
+    throw std::logic_error("CompactVolumeId accepted an unrepresentable id");
+  }
+  ids[7] = tooBig;
+  if (idents::CompactVolumeId::compact(ids, compact) != 7) {
+    throw std::logic_error("CompactVolumeId::compact did not stop");
+  }
+
+  // Built-in layouts must be what the widths compile to
+  idents::VolumeIdSchema builtin, recompiled;
+  std::istringstream none("");
+  recompiled.read(none);
+  for (unsigned s = 1; s < idents::VolumeIdentifier::eNumSubsystems; s++) {
+    idents::VolumeIdentifier::Subsystem sub = 
+      idents::VolumeIdentifier::Subsystem(s);
+    for (unsigned i = 0; i < idents::VolumeIdentifier::maxSize(); i++) {
+      if (recompiled.compactWidth(sub, i) != builtin.compactWidth(sub, i)) {
+        throw std::logic_error("built-in compact layout inconsistent");
+      }
+    }
+    const idents::VolumeIdSchema::CompactLayout& layout = 
+      idents::VolumeIdSchema::compactLayout(sub);
+    unsigned shift = 32;
+    for (unsigned i = 0; i < layout.levels; i++) {
+      shift -= layout.width[i];
+      if (layout.shift[i] != shift) {
+        throw std::logic_error("built-in compact shifts inconsistent");
+      }
+    }
+  }
+
+  const char* bad[] = {"widths Tkr 6 6 6 6 6", "widths Cal 1 3 2 1 3",
+                       "widths Acd 1 0 6", "widths Gem 1 2", 
+                       "widths Tkr 1 2 2"};
+  for (unsigned i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+    std::istringstream in(bad[i]);
+    bool caught = false;
+    try {
+      idents::VolumeIdSchema().read(in, "test");
+    } catch (std::invalid_argument&) {
+      caught = true;
+    }
+    if (!caught) {
+      throw std::logic_error(std::string("schema accepted ") + bad[i]);
+    }
+  }
+  std::cout << "CompactVolumeId converts and sorts like VolumeIdentifier"
+            << std::endl;
+}
+
+// Interned indices must be dense, distinct and invertible
+void testInternTable() {
+  std::vector<idents::VolumeIdentifier> ids = makeDetectorIds(20000);
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+  idents::VolumeIdInternTable table;
+  if (table.index(ids[0]) != idents::VolumeIdInternTable::notFound) {
+    throw std::logic_error("empty VolumeIdInternTable found an id");
+  }
+  table.build(ids);
+  std::vector<char> seen(ids.size(), 0);
+  for (unsigned i = 0; i < ids.size(); i++) {
+    unsigned int index = table.index(ids[i]);
+    if ((index >= ids.size()) || seen[index] || 
+        (table.volumeId(index) != ids[i])) {
+      throw std::logic_error("VolumeIdInternTable index not dense");
+    }
+    seen[index] = 1;
+  }
+  std::vector<idents::VolumeIdentifier> others = makeIds(5000);
+  for (unsigned i = 0; i < others.size(); i++) {
+    bool member = std::find(ids.begin(), ids.end(), others[i]) != ids.end();
+    if (table.contains(others[i]) != member) {
+      throw std::logic_error("VolumeIdInternTable found a non-member");
+    }
+  }
+
+  ids.push_back(ids[17]);
+  bool caught = false;
+  try {
+    table.build(ids);
+  } catch (std::invalid_argument&) {
+    caught = true;
+  }
+  if (!caught) {
+    throw std::logic_error("VolumeIdInternTable accepted a duplicate");
+  }
+  std::cout << "VolumeIdInternTable numbers " << ids.size() - 1 
+            << " identifiers densely" << std::endl;
+}
+
+// PackedVolumeId must read and order exactly like VolumeIdentifier
+void testPackedVolumeId() {
+  std::vector<idents::VolumeIdentifier> ids = makeIds(3000);
+  std::vector<idents::PackedVolumeId> packed;
+  for (unsigned i = 0; i < ids.size(); i++) {
+    idents::PackedVolumeId p(ids[i]);
+    if ((p.volumeId() != ids[i]) || (p.getValue() != ids[i].getValue()) ||
+        (p.size() != ids[i].size()) || (p.name() != ids[i].name()) ||
+        (p.classify() != ids[i].classify())) {
+      throw std::logic_error("PackedVolumeId does not match VolumeIdentifier");
+    }
+    for (int f = 0; f < ids[i].size(); f++) {
+      if (p[f] != ids[i][f]) {
+        throw std::logic_error("PackedVolumeId field mismatch");
+      }
+    }
+    packed.push_back(p);
+  }
+  for (unsigned i = 1; i < ids.size(); i++) {
+    if (((packed[i - 1] < packed[i]) != (ids[i - 1] < ids[i])) ||
+        ((packed[i - 1] == packed[i]) != (ids[i - 1] == ids[i])) ||
+        (packed[i].isDescendantOf(packed[i - 1]) != 
+         ids[i].isDescendantOf(ids[i - 1]))) {
+      throw std::logic_error("PackedVolumeId compares differently");
+    }
+  }
+  std::sort(ids.begin(), ids.end());
+  idents::radixSort(packed);
+  for (unsigned i = 0; i < ids.size(); i++) {
+    if (packed[i].volumeId() != ids[i]) {
+      throw std::logic_error("PackedVolumeId sorts differently");
+    }
+  }
+  std::cout << "PackedVolumeId holds an identifier in " 
+            << sizeof(idents::PackedVolumeId) << " bytes" << std::endl;
+}
+
+// Wide identifiers must order lexicographically by field, agree with
+// VolumeIdentifier when they fit, and round-trip through names
+void testWideVolumeIdentifier() {
+  std::vector<idents::VolumeIdentifier> narrow = makeIds(500);
+  for (unsigned i = 0; i < narrow.size(); i++) {
+    idents::WideVolumeIdentifier wide(narrow[i]);
+    if (!wide.fits64() || (wide.volumeId() != narrow[i]) ||
+        (wide.name() != narrow[i].name()) || 
+        (wide.classify() != narrow[i].classify())) {
+      throw std::logic_error("WideVolumeIdentifier disagrees when narrow");
+    }
+  }
+
+  // Few distinct field values so that prefixes and ties are common
+  std::vector<idents::WideVolumeIdentifier> ids;
+  std::vector<std::vector<unsigned> > fields;
+  TestRandom random(99);
+  for (unsigned i = 0; i < 2000; i++) {
+    unsigned size = random.below(21);
+    idents::WideVolumeIdentifier id;
+    std::vector<unsigned> f;
+    for (unsigned k = 0; k < size; k++) {
+      unsigned field = random.below(3) ? 0 : random.below(64);
+      id.append(field);
+      f.push_back(field);
+    }
+    idents::WideVolumeIdentifier parsed;
+    if ((idents::WideVolumeIdentifier::parse(id.name(), parsed) != 
+         idents::VolumeIdentifier::eOk) || (parsed != id) ||
+        (id.fits64() != (size <= 10))) {
+      throw std::logic_error("WideVolumeIdentifier name did not parse back");
+    }
+    ids.push_back(id);
+    fields.push_back(f);
+  }
+  for (unsigned i = 1; i < ids.size(); i++) {
+    bool descendant = (fields[i].size() >= fields[i - 1].size()) &&
+      std::equal(fields[i - 1].begin(), fields[i - 1].end(), 
+                 fields[i].begin());
+    if (((ids[i - 1] < ids[i]) != (fields[i - 1] < fields[i])) ||
+        ((ids[i] < ids[i - 1]) != (fields[i] < fields[i - 1])) ||
+        (ids[i].isDescendantOf(ids[i - 1]) != descendant)) {
+      throw std::logic_error("WideVolumeIdentifier compares wrongly");
+    }
+  }
+
+  idents::WideVolumeIdentifier head, tail;
+  for (unsigned k = 0; k < 12; k++) head.append(k);
+  for (unsigned k = 0; k < 8; k++) tail.append(50 + k);
+  idents::WideVolumeIdentifier whole(tail);
+  whole.prepend(head);
+  if ((whole.size() != 20) || (whole[11] != 11) || (whole[12] != 50) ||
+      !whole.isDescendantOf(head)) {
+    throw std::logic_error("WideVolumeIdentifier::prepend failed");
+  }
+  bool caught = false;
+  try {
+    whole.append(1);
+  } catch (std::range_error&) {
+    caught = true;
+  }
+  try {
+    whole.volumeId();
+    caught = false;
+  } catch (std::range_error&) {}
+  if (!caught) {
+    throw std::logic_error("WideVolumeIdentifier range not enforced");
+  }
+  std::cout << "WideVolumeIdentifier holds " 
+            << idents::WideVolumeIdentifier::maxSize() << " fields in " 
+            << sizeof(idents::WideVolumeIdentifier) << " bytes" << std::endl;
+}
+
+// Bulk building must agree with append(), and report bad fields
+void testBuild() {
+  typedef idents::VolumeIdentifier VId;
+  const unsigned depth = VId::maxSize();
+  const unsigned count = 1000;
+  std::vector<unsigned char> matrix(count * depth);
+  std::vector<unsigned char> sizes(count);
+  std::vector<VId> expected(count);
+  TestRandom random(7);
+  for (unsigned i = 0; i < count; i++) {
+    sizes[i] = i % (depth + 1);
+    for (unsigned k = 0; k < depth; k++) {
+      unsigned char field = random.below(64);
+      // beyond the row size anything goes
+      if (k >= sizes[i]) field |= 0xc0;
+      else expected[i].append(field);
+      matrix[i * depth + k] = field;
+    }
+    VId one;
+    if ((VId::build(&matrix[i * depth], sizes[i], one) != VId::eOk) ||
+        (one != expected[i])) {
+      throw std::logic_error("build disagrees with append");
+    }
+  }
+  std::vector<VId> out(count);
+  if ((VId::build(&matrix[0], count, depth, &out[0], &sizes[0]) != 
+       VId::eOk) || (out != expected)) {
+    throw std::logic_error("batch build disagrees with append");
+  }
+
+  unsigned char tooLarge[3] = {1, 64, 2};
+  unsigned char many[11] = {0};
+  VId id = expected[5];
+  if ((VId::build(tooLarge, 3, id) != VId::eFieldTooLarge) ||
+      (VId::build(many, 11, id) != VId::eTooManyFields) ||
+      (id != expected[5])) {
+    throw std::logic_error("build accepted bad fields");
+  }
+  std::size_t badRow = 0;
+  matrix[600 * depth + 1] = 64;
+  if ((VId::build(&matrix[0], count, depth, &out[0], &sizes[0], &badRow)
+       != VId::eFieldTooLarge) || (badRow != 600)) {
+    throw std::logic_error("batch build missed a bad row");
+  }
+  std::cout << "Bulk build agrees with append" << std::endl;
+}
+
+// unpack() and pack() of each id type against its accessors, with the
+// pext/pdep versions (where available) and the portable ones
+void testUnpack() {
+  typedef idents::VolumeIdentifier VId;
+  const bool bmi2 = idents::BitFieldLayout::usesBmi2();
+  for (int pass = 0; pass < 2; pass++) {
+    idents::BitFieldLayout::useBmi2(pass == 0);
+    unsigned char f[VId::maxSize()];
+
+    TestRandom random(11);
+    for (unsigned n = 0; n <= VId::maxSize(); n++) {
+      VId id;
+      for (unsigned k = 0; k < n; k++) id.append(random.below(64));
+      id.unpack(f);
+      VId back;
+      for (unsigned k = 0; k < VId::maxSize(); k++) {
+        if (f[k] != ((k < n) ? id[k] : 0)) {
+          throw std::logic_error("VolumeIdentifier::unpack is wrong");
+        }
+      }
+      if ((VId::build(f, n, back) != VId::eOk) || (back != id)) {
+        throw std::logic_error("VolumeIdentifier unpack/build round trip");
+      }
+    }
+
+    idents::TkrId tkr(3, 2, 17, true, idents::TkrId::eMeasureY);
+    tkr.unpack(f);
+    if ((f[idents::TkrId::eTowerXField] != 3) ||
+        (f[idents::TkrId::eTowerYField] != 2) ||
+        (f[idents::TkrId::eTrayField] != 17) ||
+        (f[idents::TkrId::eBotTopField] != 1) ||
+        (f[idents::TkrId::eViewField] != 1) ||
+        (f[idents::TkrId::eLadderField] != 0)) {
+      throw std::logic_error("TkrId::unpack is wrong");
+    }
+    // Fields which are not valid read as 0, even if their bits are set
+    idents::TkrId noView(0, 0, 100, false, idents::TkrId::eMeasureNone);
+    unsigned char g[idents::TkrId::eNumFields];
+    noView.unpack(g);
+    if (noView.hasView() || (g[idents::TkrId::eViewField] != 0)) {
+      throw std::logic_error("TkrId::unpack read an invalid view");
+    }
+    idents::TkrId::fromPackedId(0x3000).unpack(g);
+    for (unsigned k = 0; k < idents::TkrId::eNumFields; k++) {
+      if (g[k] != 0) {
+        throw std::logic_error("TkrId::unpack read an invalid ladder");
+      }
+    }
+
+    f[idents::TkrId::eLadderField] = 2;
+    f[idents::TkrId::eWaferField] = 3;
+    idents::TkrId tkr2;
+    tkr2.pack(f);
+    if ((tkr2.getTray() != 17) || (tkr2.getTowerX() != 3) ||
+        (tkr2.getLadder() != 2) || (tkr2.getWafer() != 3)) {
+      throw std::logic_error("TkrId::pack is wrong");
+    }
+    // With the validity from unpack(), ids lacking fields round trip;
+    // without it every field comes back valid
+    idents::TkrId plane(1, 2, 17, false);
+    unsigned char v[idents::TkrId::eNumFields];
+    plane.unpack(g, v);
+    idents::TkrId back, allValid;
+    back.pack(g, v);
+    allValid.pack(g);
+    if (!back.isEqual(plane) || !v[idents::TkrId::eTrayField] ||
+        v[idents::TkrId::eViewField] || v[idents::TkrId::eWaferField] ||
+        !allValid.hasView() || !allValid.hasWafer() ||
+        (allValid.getTray() != 17) || (allValid.getView() != 0)) {
+      throw std::logic_error("TkrId::pack with validity is wrong");
+    }
+
+    idents::CalXtalId cal(13, 5, 9, idents::CalXtalId::NEG,
+                          idents::CalXtalId::HEX8);
+    cal.unpack(f);
+    if ((f[idents::CalXtalId::TOWER_FIELD] != 13) ||
+        (f[idents::CalXtalId::LAYER_FIELD] != 5) ||
+        (f[idents::CalXtalId::COLUMN_FIELD] != 9) ||
+        (f[idents::CalXtalId::FACE_FIELD] != 1) ||
+        (f[idents::CalXtalId::RANGE_FIELD] != 2) ||
+        !f[idents::CalXtalId::FACE_VALID_FIELD] ||
+        !f[idents::CalXtalId::RANGE_VALID_FIELD]) {
+      throw std::logic_error("CalXtalId::unpack is wrong");
+    }
+    idents::CalXtalId cal2;
+    cal2.pack(f);
+    if (cal2.getPackedId() != cal.getPackedId()) {
+      throw std::logic_error("CalXtalId::pack is wrong");
+    }
+
+    idents::AcdId acd(0, 3, 2, 4);
+    acd.unpack(f);
+    if ((f[idents::AcdId::faceField] != 3) ||
+        (f[idents::AcdId::rowField] != 2) ||
+        (f[idents::AcdId::colField] != 4) ||
+        (f[idents::AcdId::naField] != 0)) {
+      throw std::logic_error("AcdId::unpack is wrong");
+    }
+    idents::AcdId acd2;
+    acd2.pack(f);
+    if (acd2.id() != acd.id()) {
+      throw std::logic_error("AcdId::pack is wrong");
+    }
+
+    idents::AcdGapId gap(9, 5, 4, 3, 2);
+    gap.unpack(f);
+    if ((f[idents::AcdGapId::TypeField] != 9) ||
+        (f[idents::AcdGapId::GapField] != 5) ||
+        (f[idents::AcdGapId::ColField] != 2)) {
+      throw std::logic_error("AcdGapId::unpack is wrong");
+    }
+    idents::AcdGapId gap2;
+    gap2.pack(f);
+    if (!(gap2 == gap)) throw std::logic_error("AcdGapId::pack is wrong");
+  }
+  idents::BitFieldLayout::useBmi2(bmi2);
+
+  const unsigned char shifts[2] = {0, 4};
+  const unsigned char widths[2] = {6, 4};
+  try {
+    idents::BitFieldLayout overlap(2, shifts, widths);
+    throw std::logic_error("BitFieldLayout accepted overlapping fields");
+  } catch (std::invalid_argument&) {}
+  std::cout << "Unpack and pack agree with the accessors" << std::endl;
+}
+
+void testOrderedMap() {
+  typedef idents::VolumeIdentifier VId;
+  typedef std::map<VId, unsigned> Tree;
+  std::vector<VId> ids = makeDetectorIds(3000);
+  std::vector<VId> mixed = makeMixedIds(2000);
+  ids.insert(ids.end(), mixed.begin(), mixed.end());
+  Tree tree;
+  for (unsigned i = 0; i < ids.size(); i += 2) tree[ids[i]] = i;
+
+  idents::VolumeIdOrderedMap<unsigned> flat;
+  flat.build(tree.begin(), tree.end());
+  const idents::VolumeIdOrderedMap<unsigned>& cflat = flat;
+  const Tree& ctree = tree;
+  if (flat.size() != tree.size()) {
+    throw std::logic_error("VolumeIdOrderedMap has wrong size");
+  }
+  Tree::const_iterator t = ctree.begin();
+  for (idents::VolumeIdOrderedMap<unsigned>::const_iterator it = 
+         cflat.begin(); it != cflat.end(); ++it, ++t) {
+    if ((it.key() != t->first) || (it.value() != t->second)) {
+      throw std::logic_error("VolumeIdOrderedMap iteration out of order");
+    }
+  }
+  for (unsigned i = 0; i < ids.size(); i++) {
+    const unsigned* found = flat.find(ids[i]);
+    Tree::const_iterator f = tree.find(ids[i]);
+    if (((found == 0) != (f == tree.end())) || 
+        (found && (*found != f->second))) {
+      throw std::logic_error("VolumeIdOrderedMap find disagrees with std::map");
+    }
+    Tree::const_iterator lb = ctree.lower_bound(ids[i]);
+    std::size_t rank = std::distance(ctree.begin(), lb);
+    if (flat.lower_bound(ids[i]).index() != rank) {
+      throw std::logic_error("VolumeIdOrderedMap lower_bound is wrong");
+    }
+    rank = std::distance(ctree.begin(), ctree.upper_bound(ids[i]));
+    if (flat.upper_bound(ids[i]).index() != rank) {
+      throw std::logic_error("VolumeIdOrderedMap upper_bound is wrong");
+    }
+  }
+
+  // every prefix of a few identifiers, against a linear scan
+  for (unsigned i = 0; i < ids.size(); i += 97) {
+    for (int depth = 0; depth <= ids[i].size(); depth++) {
+      VId prefix;
+      for (int k = 0; k < depth; k++) prefix.append(ids[i][k]);
+      std::size_t first = 0, count = 0;
+      for (t = ctree.begin(); t != ctree.end(); ++t) {
+        if (t->first.isDescendantOf(prefix)) count++;
+        else if (t->first < prefix) first++;
+      }
+      std::pair<idents::VolumeIdOrderedMap<unsigned>::const_iterator,
+                idents::VolumeIdOrderedMap<unsigned>::const_iterator> range =
+        cflat.subtree(prefix);
+      if ((range.first.index() != first) || 
+          (range.second.index() != first + count)) {
+        throw std::logic_error("VolumeIdOrderedMap subtree is wrong");
+      }
+    }
+  }
+
+  std::vector<VId> unsorted(ids.begin(), ids.begin() + 10);
+  std::vector<unsigned> values(10, 0);
+  try {
+    flat.build(&unsorted[0], &values[0], unsorted.size());
+    throw std::logic_error("VolumeIdOrderedMap accepted unsorted input");
+  } catch (std::invalid_argument&) {}
+  std::cout << "VolumeIdOrderedMap agrees with std::map" << std::endl;
+}
+
+// Adds the product of the payloads of joined records
+struct JoinSum {
+  JoinSum(unsigned& sum) : m_sum(sum) {}
+  void operator()(const std::pair<idents::VolumeIdentifier, unsigned>& a,
+                  const std::pair<idents::VolumeIdentifier, unsigned>& b) {
+    m_sum += a.second * b.second;
+  }
+  unsigned& m_sum;
+};
+
+void testSetOperations() {
+  typedef idents::VolumeIdentifier VId;
+  std::vector<VId> all = makeDetectorIds(2000);
+  std::vector<VId> mixed = makeMixedIds(1000);
+  all.insert(all.end(), mixed.begin(), mixed.end());
+  std::sort(all.begin(), all.end());
+  all.erase(std::unique(all.begin(), all.end()), all.end());
+
+  for (unsigned i = 0; i < all.size(); i += 37) {
+    for (unsigned j = i; j < all.size(); j += 101) {
+      unsigned depth = 0;
+      while ((depth < (unsigned) std::min(all[i].size(), all[j].size())) &&
+             (all[i][depth] == all[j][depth])) depth++;
+      if ((idents::commonPrefixDepth(all[i], all[j]) != depth) ||
+          (idents::commonPrefixDepth(all[j], all[i]) != depth)) {
+        throw std::logic_error("commonPrefixDepth is wrong");
+      }
+    }
+  }
+
+  const std::vector<idents::SimdLevel::Level> levels = simdLevels();
+  TestRandom random(5);
+  for (unsigned trial = 0; trial < 40; trial++) {
+    // small trials exercise the tails, large ones the blocks
+    const unsigned limit = (trial < 20) ? trial : all.size();
+    std::vector<VId> a, b;
+    for (unsigned i = 0; i < limit; i++) {
+      if (random.below(3) != 0) a.push_back(all[i]);
+      if (random.below(2) != 0) b.push_back(all[i]);
+    }
+    std::vector<VId> intersection, difference;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                          std::back_inserter(intersection));
+    std::set_difference(a.begin(), a.end(), b.begin(), b.end(),
+                        std::back_inserter(difference));
+    for (unsigned l = 0; l < levels.size(); l++) {
+      idents::SimdLevel::use(levels[l]);
+      std::vector<VId> out(a.size() + 1);
+      out.resize(idents::intersectSorted(a.empty() ? 0 : &a[0], a.size(),
+                                         b.empty() ? 0 : &b[0], b.size(),
+                                         &out[0]));
+      if (out != intersection) {
+        throw std::logic_error("intersectSorted disagrees with std::set_intersection");
+      }
+      // in place
+      std::vector<VId> inPlace(a);
+      inPlace.push_back(VId());
+      inPlace.resize(idents::differenceSorted(&inPlace[0], a.size(),
+                                              b.empty() ? 0 : &b[0], 
+                                              b.size(), &inPlace[0]));
+      if (inPlace != difference) {
+        throw std::logic_error("differenceSorted disagrees with std::set_difference");
+      }
+    }
+  }
+  idents::SimdLevel::use(idents::SimdLevel::detected());
+
+  // records with repeated identifiers, against nested loops
+  typedef std::vector<std::pair<VId, unsigned> > Records;
+  Records hits, truth;
+  for (unsigned i = 0; i < 300; i++) {
+    hits.push_back(std::make_pair(all[random.below(50)], i));
+    truth.push_back(std::make_pair(all[random.below(50)], 2 * i + 1));
+  }
+  std::sort(hits.begin(), hits.end());
+  std::sort(truth.begin(), truth.end());
+  unsigned sum = 0, expectedSum = 0;
+  std::size_t calls = 0;
+  for (unsigned i = 0; i < hits.size(); i++) {
+    for (unsigned j = 0; j < truth.size(); j++) {
+      if (hits[i].first == truth[j].first) {
+        expectedSum += hits[i].second * truth[j].second;
+        calls++;
+      }
+    }
+  }
+  if ((idents::mergeJoin(hits.begin(), hits.end(), truth.begin(), truth.end(),
+                         idents::FirstOf(), idents::FirstOf(), JoinSum(sum))
+       != calls) || (sum != expectedSum)) {
+    throw std::logic_error("mergeJoin disagrees with nested loops");
+  }
+  std::cout << "Sorted set operations agree with the standard algorithms"
+            << std::endl;
+}
+
+void testAggregator() {
+  typedef idents::VolumeIdentifier VId;
+  std::vector<VId> ids = makeDetectorIds(2000);
+  std::vector<VId> mixed = makeMixedIds(500);
+  ids.insert(ids.end(), mixed.begin(), mixed.end());
+  // repeat some identifiers, as several hits in one volume would
+  ids.insert(ids.end(), ids.begin(), ids.begin() + 300);
+  std::sort(ids.begin(), ids.end());
+  std::vector<double> values(ids.size());
+  for (unsigned i = 0; i < ids.size(); i++) values[i] = (i * 7919) % 1000 - 300;
+
+  const unsigned depths[] = {9, 7, 0, 3, 5};
+  const unsigned nDepths = sizeof(depths) / sizeof(depths[0]);
+  idents::VolumeIdAggregator agg(depths, nDepths);
+  agg.run(&ids[0], &values[0], ids.size());
+
+  for (unsigned k = 0; k < nDepths; k++) {
+    // brute force: a std::map keyed on the prefix
+    std::map<VId, idents::VolumeIdAggregator::Group> expected;
+    for (unsigned i = 0; i < ids.size(); i++) {
+      if ((unsigned) ids[i].size() < depths[k]) continue;
+      VId prefix;
+      for (unsigned f = 0; f < depths[k]; f++) prefix.append(ids[i][f]);
+      std::map<VId, idents::VolumeIdAggregator::Group>::iterator it =
+        expected.find(prefix);
+      if (it == expected.end()) {
+        idents::VolumeIdAggregator::Group g = 
+          {prefix, 0, 0.0, values[i], values[i]};
+        it = expected.insert(std::make_pair(prefix, g)).first;
+      }
+      it->second.count++;
+      it->second.sum += values[i];
+      it->second.min = std::min(it->second.min, values[i]);
+      it->second.max = std::max(it->second.max, values[i]);
+    }
+    const std::vector<idents::VolumeIdAggregator::Group>& groups = 
+      agg.groups(k);
+    if ((agg.depth(k) != depths[k]) || (groups.size() != expected.size())) {
+      throw std::logic_error("VolumeIdAggregator has wrong groups");
+    }
+    std::map<VId, idents::VolumeIdAggregator::Group>::const_iterator e =
+      expected.begin();
+    for (unsigned g = 0; g < groups.size(); g++, ++e) {
+      if ((groups[g].prefix != e->first) || 
+          (groups[g].count != e->second.count) ||
+          (groups[g].sum != e->second.sum) ||
+          (groups[g].min != e->second.min) ||
+          (groups[g].max != e->second.max)) {
+        throw std::logic_error("VolumeIdAggregator disagrees with std::map");
+      }
+    }
+  }
+
+  std::swap(ids[10], ids[20]);
+  try {
+    agg.run(&ids[0], &values[0], ids.size());
+    throw std::logic_error("VolumeIdAggregator accepted unsorted input");
+  } catch (std::invalid_argument&) {}
+  std::cout << "VolumeIdAggregator rolls up " << ids.size() 
+            << " values to " << nDepths << " depths" << std::endl;
+}
+
+/// One thread's share of the registry test: insert every identifier,
+/// starting at a different place from the other threads
+struct RegistryWork {
+  idents::VolumeIdRegistry<unsigned>* registry;
+  const std::vector<idents::VolumeIdentifier>* ids;
+  unsigned thread;
+  unsigned nThreads;
+  unsigned inserted;
+  unsigned pending;
+  unsigned wrong;
+};
+
+extern "C" void* registryWork(void* arg) {
+  RegistryWork& work = *static_cast<RegistryWork*>(arg);
+  const std::vector<idents::VolumeIdentifier>& ids = *work.ids;
+  const unsigned n = ids.size();
+  for (unsigned k = 0; k < n; k++) {
+    const unsigned i = (k + work.thread * n / work.nThreads) % n;
+    idents::VolumeIdRegistry<unsigned>::InsertResult r = 
+      work.registry->insert(ids[i], 3 * i);
+    if (r.pending) work.pending++;
+    else if (!r.value || (*r.value != 3 * i)) work.wrong++;
+    else if (r.inserted) work.inserted++;
+  }
+  return 0;
+}
+
+void testRegistry() {
+  typedef idents::VolumeIdentifier VId;
+  std::vector<VId> ids = makeDetectorIds(3000);
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  const int n = ids.size();
+
+  // Several threads insert the same identifiers into a registry of
+  // exactly their number: each must be inserted once, and none may be
+  // refused for want of room
+  idents::VolumeIdRegistry<unsigned> registry(n);
+  const unsigned nThreads = 8;
+  RegistryWork work[nThreads];
+  for (unsigned t = 0; t < nThreads; t++) {
+    RegistryWork w = {&registry, &ids, t, nThreads, 0, 0, 0};
+    work[t] = w;
+  }
+#ifndef WIN32
+  pthread_t threads[nThreads];
+  for (unsigned t = 0; t < nThreads; t++) {
+    if (pthread_create(&threads[t], 0, registryWork, &work[t]) != 0) {
+      throw std::runtime_error("could not start registry test thread");
+    }
+  }
+  for (unsigned t = 0; t < nThreads; t++) pthread_join(threads[t], 0);
+#else
+  for (unsigned t = 0; t < nThreads; t++) registryWork(&work[t]);
+#endif
+  int inserted = 0;
+  for (unsigned t = 0; t < nThreads; t++) {
+    if (work[t].wrong) {
+      throw std::logic_error("VolumeIdRegistry refused or mangled an insert");
+    }
+    inserted += work[t].inserted;
+  }
+  if ((inserted != n) || (registry.size() != (std::size_t) n)) {
+    throw std::logic_error("VolumeIdRegistry inserted wrongly");
+  }
+  // Once all inserts are done nothing is pending
+  for (int i = 0; i < n; i++) {
+    idents::VolumeIdRegistry<unsigned>::InsertResult r = 
+      registry.insert(ids[i], 0);
+    if (r.pending || r.inserted || !r.value || (*r.value != 3u * i)) {
+      throw std::logic_error("VolumeIdRegistry insert of a present id");
+    }
+  }
+
+  VId absent;
+  absent.append(63);
+  if (registry.contains(absent) || (registry.insert(absent, 0).value != 0)) {
+    throw std::logic_error("VolumeIdRegistry went beyond its capacity");
+  }
+  idents::VolumeIdMap<unsigned> frozen;
+  registry.freeze(frozen);
+  if (frozen.size() != (std::size_t) n) {
+    throw std::logic_error("VolumeIdRegistry froze wrong size");
+  }
+  for (int i = 0; i < n; i++) {
+    const unsigned* value = registry.find(ids[i]);
+    const unsigned* copy = frozen.find(ids[i]);
+    if (!value || !copy || (*value != (unsigned) (3 * i)) || 
+        (*copy != *value)) {
+      throw std::logic_error("VolumeIdRegistry lost an entry");
+    }
+  }
+  std::cout << "VolumeIdRegistry holds " << n << " identifiers" << std::endl;
+}
+
+/// TkrIds of every kind: from tracker VolumeIdentifiers of each
+/// depth, from planes with and without a view, and empty
+std::vector<idents::TkrId> makeTkrIds(unsigned n, 
+                                      const IdShape& shape = detectorShape) {
+  std::vector<idents::VolumeIdentifier> vids = makeDetectorIds(3 * n, shape);
+  std::vector<idents::TkrId> ids;
+  for (unsigned i = 0; ids.size() < n; i++) {
+    switch (i % 4) {
+    case 0:
+      ids.push_back(idents::TkrId(i % 4, (i / 4) % 4, i % 19, i % 3 == 0,
+                                  (i / 3) % 3));
+      break;
+    case 1:
+      if (i % 9 == 1) ids.push_back(idents::TkrId());
+      break;
+    default:
+      if (vids[i].isTkr()) ids.push_back(idents::TkrId(vids[i]));
+    }
+  }
+  // A measure value of 2 spills into the (absent) BotTop field
+  idents::VolumeIdentifier spill;
+  spill.append(0); spill.append(1); spill.append(2); spill.append(1);
+  spill.append(7); spill.append(2);
+  ids[n / 2].copy(idents::TkrId(spill));
+  return ids;
+}
+
+void testTkrIdColumns() {
+  std::vector<idents::TkrId> ids = makeTkrIds(1001);
+  const std::vector<idents::SimdLevel::Level> levels = simdLevels();
+  for (unsigned l = 0; l < levels.size(); l++) {
+    idents::SimdLevel::use(levels[l]);
+    idents::TkrIdColumns columns;
+    columns.decode(ids);
+    for (unsigned i = 0; i < ids.size(); i++) {
+      const idents::TkrId& id = ids[i];
+      unsigned value[idents::TkrId::eNumFields];
+      bool has[idents::TkrId::eNumFields] = {
+        id.getTowerY(value[0]), id.getTowerX(value[1]), id.getTray(value[2]),
+        id.getView(value[3]), id.getBotTop(value[4]), id.getLadder(value[5]),
+        id.getWafer(value[6])
+      };
+      if ((has[2] != id.hasTray()) || (has[2] && (value[2] != id.getTray())) ||
+          (has[6] != id.hasWafer()) || (has[6] && (value[6] != id.getWafer()))) {
+        throw std::logic_error("non-throwing TkrId getters disagree");
+      }
+      for (unsigned k = 0; k < idents::TkrId::eNumFields; k++) {
+        const bool valid = 
+          (columns.valid()[i] & idents::TkrIdColumns::validBit(k)) != 0;
+        if ((valid != has[k]) || 
+            (columns.field(k)[i] != (has[k] ? value[k] : 0))) {
+          throw std::logic_error("TkrIdColumns disagrees with the getters");
+        }
+      }
+    }
+  }
+  idents::SimdLevel::use(idents::SimdLevel::detected());
+  idents::TkrIdColumns empty;
+  empty.decode(std::vector<idents::TkrId>());
+  if ((empty.count() != 0) || empty.field(0) || empty.valid()) {
+    throw std::logic_error("empty TkrIdColumns has columns");
+  }
+  std::cout << "Decoded " << ids.size() << " TkrIds into columns" << std::endl;
+}
+
+void testTkrIdBuild() {
+  typedef idents::VolumeIdentifier VId;
+  // Tracker-like identifiers with any field values, including ones too
+  // large for their TkrId fields, and the other subsystems
+  std::vector<VId> vids = makeDetectorIds(1500);
+  TestRandom random(99);
+  for (unsigned i = 0; i < 1500; i++) {
+    VId id;
+    const unsigned size = i % 11;
+    for (unsigned k = 0; k < size; k++) {
+      unsigned field = random.below(64);
+      if (k == 0) field &= 1;
+      else if (k == 3) field = (field & 3) ? 1 : 0;
+      else if (((k == 1) || (k == 2)) && (i % 5)) field &= 3;
+      id.append(field);
+    }
+    vids.push_back(id);
+  }
+  std::vector<idents::TkrId> expected(vids.size());
+  std::vector<unsigned char> expectedOk(vids.size());
+  std::size_t expectedValid = 0;
+  for (unsigned i = 0; i < vids.size(); i++) {
+    try {
+      expected[i].copy(idents::TkrId(vids[i]));
+      expectedOk[i] = 1;
+    } catch (std::invalid_argument&) {
+      expectedOk[i] = 0;
+    }
+    expectedValid += expectedOk[i];
+  }
+
+  const std::vector<idents::SimdLevel::Level> levels = simdLevels();
+  std::size_t nValid = 0;
+  for (unsigned l = 0; l < levels.size(); l++) {
+    idents::SimdLevel::use(levels[l]);
+    std::vector<idents::TkrId> out(vids.size());
+    std::vector<unsigned char> valid(vids.size());
+    nValid = idents::TkrId::build(&vids[0], vids.size(), &out[0], &valid[0]);
+    for (unsigned i = 0; i < vids.size(); i++) {
+      if ((valid[i] != expectedOk[i]) || !out[i].isEqual(expected[i])) {
+        throw std::logic_error("TkrId::build disagrees with the constructor");
+      }
+    }
+    if (nValid != expectedValid) {
+      throw std::logic_error("TkrId::build miscounted");
+    }
+  }
+  idents::SimdLevel::use(idents::SimdLevel::detected());
+  std::cout << "TkrId::build converted " << nValid << " of " << vids.size()
+            << " identifiers" << std::endl;
+}
+
+void testTkrPlaneIndex() {
+  idents::TkrPlaneIndex planes;
+  if (planes.size() != 16 * 19 * 4) {
+    throw std::logic_error("TkrPlaneIndex has the wrong number of planes");
+  }
+  unsigned nNeighbors = 0;
+  for (unsigned p = 0; p < planes.size(); p++) {
+    const idents::TkrId id = planes.tkrId(p);
+    if (planes.index(id) != p) {
+      throw std::logic_error("TkrPlaneIndex does not round-trip");
+    }
+    const unsigned z = 2 * planes.tray(p) + planes.botTop(p);
+    const unsigned above = planes.above(p), below = planes.below(p);
+    if ((above == idents::TkrPlaneIndex::npos) != (z == 2 * 19 - 1) ||
+        (below == idents::TkrPlaneIndex::npos) != (z == 0) ||
+        ((above != idents::TkrPlaneIndex::npos) &&
+         ((2 * planes.tray(above) + planes.botTop(above) != z + 1) ||
+          (planes.tower(above).id() != planes.tower(p).id()) ||
+          (planes.view(above) != planes.view(p)) ||
+          (planes.below(above) != p)))) {
+      throw std::logic_error("TkrPlaneIndex above/below is wrong");
+    }
+    const unsigned other = planes.otherView(p);
+    if ((planes.view(other) == planes.view(p)) ||
+        (planes.tray(other) != planes.tray(p)) ||
+        (planes.botTop(other) != planes.botTop(p)) ||
+        (planes.otherView(other) != p)) {
+      throw std::logic_error("TkrPlaneIndex otherView is wrong");
+    }
+    const idents::TowerId tower = planes.tower(p);
+    unsigned expected = 0;
+    for (unsigned t = 0; t < 16; t++) {
+      if ((t != (unsigned) tower.id()) && tower.neighbor(idents::TowerId(t))) {
+        expected++;
+      }
+    }
+    if (planes.nNeighbors(p) != expected) {
+      throw std::logic_error("TkrPlaneIndex has the wrong neighbours");
+    }
+    for (unsigned k = 0; k < planes.nNeighbors(p); k++) {
+      const unsigned n = planes.neighbors(p)[k];
+      if (!tower.neighbor(planes.tower(n)) || 
+          (planes.tower(n).id() == tower.id()) ||
+          (planes.tray(n) != planes.tray(p)) ||
+          (planes.botTop(n) != planes.botTop(p)) ||
+          (planes.view(n) != planes.view(p))) {
+        throw std::logic_error("TkrPlaneIndex neighbour is wrong");
+      }
+    }
+    nNeighbors += planes.nNeighbors(p);
+  }
+  // Incomplete or out of range TkrIds have no plane
+  if ((planes.index(idents::TkrId()) != idents::TkrPlaneIndex::npos) ||
+      (planes.index(idents::TkrId(1, 2, 5, true)) != 
+       idents::TkrPlaneIndex::npos) ||
+      (planes.index(idents::TkrId(1, 2, 19, true, 0)) != 
+       idents::TkrPlaneIndex::npos)) {
+    throw std::logic_error("TkrPlaneIndex indexed an incomplete TkrId");
+  }
+  std::cout << "TkrPlaneIndex: " << planes.size() << " planes, " 
+            << nNeighbors << " neighbour links" << std::endl;
+}
+
+void testTkrStripId() {
+  typedef idents::TkrStripId Strip;
+  const Strip a(idents::TowerId(2, 3), 17, 1, 0, 1535);
+  const Strip b(a.getTkrId(), 1536);
+  if ((a.getTower().id() != idents::TowerId(2, 3).id()) || 
+      (a.getTray() != 17) || (a.getBotTop() != 1) || (a.getView() != 0) ||
+      (a.getStrip() != 1535) || (b.word() != a.word() + 1) || 
+      !a.samePlane(b)) {
+    throw std::logic_error("TkrStripId fields are wrong");
+  }
+  bool threw = false;
+  try {
+    Strip(idents::TkrId(1, 1, 3, true), 5);   // no view
+  } catch (std::invalid_argument&) {
+    threw = true;
+  }
+  if (!threw) throw std::logic_error("TkrStripId accepted a TkrId lacking view");
+
+  // Hits in clusters of a few strips, some repeated, with some strips
+  // at the ends of the strip range and trays beyond the usual 19
+  std::vector<Strip> hits;
+  TestRandom random(7);
+  for (unsigned c = 0; c < 3000; c++) {
+    const idents::TowerId tower(random.below(16));
+    const unsigned tray = random.below(21);
+    const unsigned botTop = random.below(2);
+    const unsigned view = random.below(2);
+    unsigned strip = random.below(1536);
+    if (c % 50 == 0) strip = 2046;
+    const unsigned width = 1 + random.below(4);
+    for (unsigned k = 0; k < width && strip + k <= Strip::MASKStrip; k++) {
+      hits.push_back(Strip(tower, tray, botTop, view, strip + k));
+      if (k == 1 && (c % 7 == 0)) hits.push_back(hits.back());
+    }
+    if (c % 50 == 0) {
+      // strip 0 of the next plane must start a new run
+      hits.push_back(Strip(hits.back().word() + 1));
+    }
+  }
+  std::vector<Strip> sorted(hits);
+  std::sort(sorted.begin(), sorted.end());
+  std::vector<Strip> radix(hits);
+  idents::radixSort(radix);
+  if (radix != sorted) throw std::logic_error("radixSort of TkrStripIds is wrong");
+
+  std::size_t expectedRuns = 1;
+  for (unsigned i = 1; i < sorted.size(); i++) {
+    const bool continues = (sorted[i] == sorted[i - 1]) ||
+      (sorted[i].samePlane(sorted[i - 1]) && 
+       (sorted[i].getStrip() == sorted[i - 1].getStrip() + 1));
+    if (!continues) expectedRuns++;
+  }
+  const std::vector<idents::SimdLevel::Level> levels = simdLevels();
+  for (unsigned l = 0; l < levels.size(); l++) {
+    idents::SimdLevel::use(levels[l]);
+    std::vector<idents::TkrStripRun> runs;
+    const std::size_t nRuns = 
+      idents::findStripRuns(&sorted[0], sorted.size(), runs);
+    if ((nRuns != expectedRuns) || (runs.size() != nRuns) || 
+        (runs.front().begin != 0) || (runs.back().end != sorted.size())) {
+      throw std::logic_error("findStripRuns found the wrong runs");
+    }
+    for (unsigned r = 0; r < runs.size(); r++) {
+      if ((r > 0) && (runs[r].begin != runs[r - 1].end)) {
+        throw std::logic_error("findStripRuns left a gap");
+      }
+      for (std::size_t i = runs[r].begin + 1; i < runs[r].end; i++) {
+        if (!sorted[i].samePlane(sorted[runs[r].begin]) ||
+            (sorted[i].getStrip() - sorted[i - 1].getStrip() > 1)) {
+          throw std::logic_error("findStripRuns joined distant strips");
+        }
+      }
+    }
+    threw = false;
+    try {
+      idents::findStripRuns(&hits[0], hits.size(), runs);
+    } catch (std::invalid_argument&) {
+      threw = true;
+    }
+    if (!threw) throw std::logic_error("findStripRuns accepted unsorted ids");
+  }
+  idents::SimdLevel::use(idents::SimdLevel::detected());
+
+  idents::TkrPlaneIndex planes;
+  std::vector<unsigned> counts;
+  std::size_t skipped = 
+    idents::countStripsPerPlane(&hits[0], hits.size(), planes, counts);
+  std::vector<unsigned> expected(planes.size(), 0);
+  std::size_t expectedSkipped = 0;
+  for (unsigned i = 0; i < hits.size(); i++) {
+    const unsigned plane = planes.index(hits[i].getTkrId());
+    if (plane == idents::TkrPlaneIndex::npos) expectedSkipped++;
+    else expected[plane]++;
+  }
+  if ((counts != expected) || (skipped != expectedSkipped)) {
+    throw std::logic_error("countStripsPerPlane is wrong");
+  }
+  std::cout << "TkrStripId: " << hits.size() << " hits in " << expectedRuns
+            << " runs" << std::endl;
+}
+
+void testNarrowIds() {
+  if ((sizeof(idents::TkrId32) != 4) || (sizeof(idents::CalXtalId16) != 2) ||
+      (sizeof(idents::AcdId16) != 2)) {
+    throw std::logic_error("narrow ids are not narrow");
+  }
+  std::vector<idents::TkrId> tkrIds = makeTkrIds(1001);
+  idents::NarrowIdVector<idents::TkrId32> tkr(tkrIds.begin(), tkrIds.end());
+  unsigned i = 0;
+  for (idents::NarrowIdVector<idents::TkrId32>::const_iterator it = tkr.begin();
+       it != tkr.end(); ++it, ++i) {
+    if (!tkrIds[i].isEqual(*it) || 
+        !tkrIds[i].isEqual(idents::TkrId::fromPackedId
+                           (tkrIds[i].getPackedId()))) {
+      throw std::logic_error("TkrId32 does not round-trip");
+    }
+    if ((i > 0) && ((tkrIds[i - 1] < tkrIds[i]) != 
+                    (idents::TkrId32(tkrIds[i - 1]) < 
+                     idents::TkrId32(tkrIds[i])))) {
+      throw std::logic_error("TkrId32 orders differently from TkrId");
+    }
+  }
+  if ((tkr.size() != tkrIds.size()) || (tkr.end() - tkr.begin() != 1001)) {
+    throw std::logic_error("NarrowIdVector has the wrong size");
+  }
+  tkr.set(3, tkrIds[7]);
+  if (!tkr[3].isEqual(tkrIds[7])) {
+    throw std::logic_error("NarrowIdVector::set did not replace the id");
+  }
+
+  idents::NarrowIdVector<idents::CalXtalId16> cal;
+  for (short tower = 0; tower < 16; tower++) {
+    for (short face = idents::CalXtalId::FACE_UNUSED; face <= 1; face++) {
+      for (short range = idents::CalXtalId::RANGE_UNUSED; range <= 3; range++) {
+        cal.push_back(idents::CalXtalId(tower, tower % 8, 11 - tower % 12, 
+                                        face, range));
+      }
+    }
+  }
+  for (i = 0; i < cal.size(); i++) {
+    const idents::CalXtalId full = cal[i];
+    const short face = (i / 5) % 3 - 1, range = i % 5 - 1;
+    const short tower = i / 15;
+    if ((full.getTower() != tower) || (full.getFace() != face) ||
+        (full.getRange() != range) || (full.getColumn() != 11 - tower % 12)) {
+      throw std::logic_error("CalXtalId16 does not round-trip");
+    }
+  }
+
+  idents::NarrowIdVector<idents::AcdId16> acd;
+  acd.push_back(idents::AcdId(0, 4, 3, 2));
+  acd.push_back(idents::AcdId(1, 0, 0, 9));
+  acd.push_back(idents::AcdId(6, 3));
+  if ((acd[0].face() != 4) || (acd[0].row() != 3) || (acd[0].column() != 2) ||
+      !acd[1].na() || (acd[2].ribbonOrientation() != 6) || 
+      (acd[2].ribbonNum() != 3)) {
+    throw std::logic_error("AcdId16 does not round-trip");
+  }
+
+  bool threw = false;
+  try {
+    idents::CalXtalId16 narrow(idents::CalXtalId(0x12345));
+  } catch (std::invalid_argument&) {
+    threw = true;
+  }
+  if (!threw) throw std::logic_error("CalXtalId16 accepted a wide id");
+
+  // Only a corrupt TkrId has bits beyond 32, such as one copied in
+  // from raw storage
+  if ((sizeof(idents::TkrId) == sizeof(unsigned long)) && 
+      (sizeof(unsigned long) > 4)) {
+    const unsigned long wide = 
+      ((unsigned long) 1 << (8 * sizeof(unsigned long) - 8)) | 0x3000;
+    idents::TkrId tkrWide;
+    std::memcpy((void*) &tkrWide, &wide, sizeof(wide));
+    threw = false;
+    try {
+      idents::TkrId32 narrow(tkrWide);
+    } catch (std::invalid_argument&) {
+      threw = true;
+    }
+    if (!threw) throw std::logic_error("TkrId32 accepted a wide id");
+  }
+
+  std::cout << "Narrow ids: " << tkr.size() * sizeof(idents::TkrId32) 
+            << " bytes for " << tkr.size() << " TkrIds" << std::endl;
+}
 
 int main() 
 {
@@ -33,6 +1756,47 @@ int main()
     }
   std::cout << std::endl;
 
+  idents::VolumeIdentifier wide;
+  for (unsigned f = 0; f < 10; f++) wide.append(63 - f);
+  idVect.push_back(wide);
+  idVect.push_back(idents::VolumeIdentifier());
+  if ((wide.name() != "/63/62/61/60/59/58/57/56/55/54") ||
+      (idents::VolumeIdentifier().name() != "")) {
+    throw std::logic_error("unexpected result from name()");
+  }
+  idents::VolumeIdentifier acdTilePrefix;
+  acdTilePrefix.append(1); acdTilePrefix.append(4); acdTilePrefix.append(40);
+  if (!(idents::VolumeIdentifier::make<1, 4, 40>() == acdTilePrefix) ||
+      !(idents::VolumeIdentifier::make<63, 62, 61, 60, 59, 58, 57, 56, 55,
+                                       54>() == wide) ||
+      !(idents::VolumeIdentifier::make<1, 1, 0>() == id3)) {
+    throw std::logic_error("VolumeIdentifier::make disagrees with append");
+  }
+  testNames(idVect);
+  testParse(idVect);
+  testColumns();
+  testVolumeIdMap();
+  testTrie();
+  testRadixSort();
+  testClassify();
+  testSchema();
+  testCompact();
+  testInternTable();
+  testPackedVolumeId();
+  testWideVolumeIdentifier();
+  testBuild();
+  testUnpack();
+  testOrderedMap();
+  testSetOperations();
+  testAggregator();
+  testRegistry();
+  testTkrIdColumns();
+  testTkrIdBuild();
+  testTkrPlaneIndex();
+  testTkrStripId();
+  testNarrowIds();
+  idVect.resize(3);
+
   std::map<idents::VolumeIdentifier,double> idMap;
   idMap[id1] = 1.5;
   idMap[id2] = 2.5;